@@ -0,0 +1,198 @@
+#ifndef NEROLL_SCRIPT_DETAIL_ARENA_H
+#define NEROLL_SCRIPT_DETAIL_ARENA_H
+
+#include <algorithm>    // max
+#include <cstddef>      // size_t, max_align_t, byte
+#include <cstdint>      // uintptr_t
+#include <memory>       // unique_ptr, make_unique_for_overwrite, uninitialized_copy
+#include <new>          // launder
+#include <span>         // span
+#include <type_traits>  // is_trivially_destructible_v
+#include <utility>      // forward, exchange
+#include <vector>       // vector
+
+namespace neroll::script::detail {
+
+// bump allocator, objects made in it live until the arena is destroyed
+// and are freed together with it, chunk by chunk
+//
+// a destroyed arena hands its chunks to the thread destroying it and the
+// next arena made on that thread takes them first, so many small arenas,
+// one per script, go to the heap no more often than one large one
+class arena {
+ public:
+    constexpr static std::size_t chunk_size = 64 * 1024;
+    // chunks a thread keeps for the next arenas, the rest go to the heap
+    constexpr static std::size_t max_free_chunks = 64;
+
+    arena() = default;
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    arena(arena &&other) noexcept
+        : chunks_(std::move(other.chunks_)),
+          large_chunks_(std::move(other.large_chunks_)),
+          next_(std::exchange(other.next_, nullptr)),
+          remaining_(std::exchange(other.remaining_, 0)),
+          cleanups_(std::exchange(other.cleanups_, nullptr)),
+          used_(std::exchange(other.used_, 0)),
+          reserved_(std::exchange(other.reserved_, 0)) {}
+
+    arena& operator=(arena &&other) noexcept {
+        if (this != &other) {
+            destroy();
+            chunks_ = std::move(other.chunks_);
+            large_chunks_ = std::move(other.large_chunks_);
+            next_ = std::exchange(other.next_, nullptr);
+            remaining_ = std::exchange(other.remaining_, 0);
+            cleanups_ = std::exchange(other.cleanups_, nullptr);
+            used_ = std::exchange(other.used_, 0);
+            reserved_ = std::exchange(other.reserved_, 0);
+        }
+        return *this;
+    }
+
+    ~arena() {
+        destroy();
+    }
+
+    // objects with a destructor get a cleanup record in front of them,
+    // the destructors run in reverse order of construction
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        } else {
+            constexpr std::size_t offset = (sizeof(cleanup) + alignof(T) - 1) / alignof(T) * alignof(T);
+            std::byte *memory = allocate(offset + sizeof(T), std::max(alignof(T), alignof(cleanup)));
+            T *object = new (memory + offset) T(std::forward<Args>(args)...);
+            // only once the constructor has not thrown
+            cleanups_ = new (memory) cleanup{cleanups_, [](cleanup *c) {
+                std::launder(reinterpret_cast<T *>(reinterpret_cast<std::byte *>(c) + offset))->~T();
+            }};
+            return object;
+        }
+    }
+
+    // copies trivially destructible elements, e.g. node pointers
+    template <typename T>
+        requires std::is_trivially_destructible_v<T>
+    std::span<T> copy(std::span<const T> elements) {
+        if (elements.empty()) {
+            return {};
+        }
+        T *data = reinterpret_cast<T *>(allocate(elements.size_bytes(), alignof(T)));
+        std::uninitialized_copy(elements.begin(), elements.end(), data);
+        return {data, elements.size()};
+    }
+
+    // bytes handed out so far, padding included
+    [[nodiscard]]
+    std::size_t bytes_used() const noexcept {
+        return used_;
+    }
+
+    // bytes taken by the chunks, what is still free in them included
+    [[nodiscard]]
+    std::size_t bytes_reserved() const noexcept {
+        return reserved_;
+    }
+
+ private:
+    // the object follows its record at a fixed offset
+    struct cleanup {
+        cleanup *next;
+        void (*destroy)(cleanup *);
+    };
+
+    // the chunks of destroyed arenas, for the next arenas of the thread
+    struct chunk_list {
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+
+        chunk_list() {
+            destroyed() = false;
+        }
+
+        ~chunk_list() {
+            destroyed() = true;
+        }
+
+        // an arena may outlive the list, e.g. one in a static object
+        static bool &destroyed() noexcept {
+            thread_local bool flag = false;
+            return flag;
+        }
+    };
+
+    static chunk_list *free_chunks() noexcept {
+        if (chunk_list::destroyed()) {
+            return nullptr;
+        }
+        thread_local chunk_list list;
+        return &list;
+    }
+
+    // chunk_size each
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    // allocations larger than a chunk
+    std::vector<std::unique_ptr<std::byte[]>> large_chunks_;
+    std::byte *next_ = nullptr;
+    std::size_t remaining_ = 0;
+    cleanup *cleanups_ = nullptr;
+    std::size_t used_ = 0;
+    std::size_t reserved_ = 0;
+
+    std::byte *allocate(std::size_t size, std::size_t alignment) {
+        std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(next_) % alignment) % alignment;
+        if (padding + size > remaining_) {
+            // chunks are aligned for any object, so no padding is needed
+            if (size > chunk_size) {
+                // a chunk of its own, the current one stays in use
+                large_chunks_.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+                reserved_ += size;
+                used_ += size;
+                return large_chunks_.back().get();
+            }
+            chunk_list *free = free_chunks();
+            if (free != nullptr && !free->chunks.empty()) {
+                chunks_.push_back(std::move(free->chunks.back()));
+                free->chunks.pop_back();
+            } else {
+                chunks_.push_back(std::make_unique_for_overwrite<std::byte[]>(chunk_size));
+            }
+            next_ = chunks_.back().get();
+            remaining_ = chunk_size;
+            reserved_ += chunk_size;
+            padding = 0;
+        }
+        std::byte *result = next_ + padding;
+        next_ += padding + size;
+        remaining_ -= padding + size;
+        used_ += padding + size;
+        return result;
+    }
+
+    void destroy() noexcept {
+        for (cleanup *c = cleanups_; c != nullptr; c = c->next) {
+            c->destroy(c);
+        }
+        cleanups_ = nullptr;
+        if (chunk_list *free = free_chunks(); free != nullptr) {
+            for (std::size_t i = 0; i < chunks_.size() && free->chunks.size() < max_free_chunks; i++) {
+                free->chunks.push_back(std::move(chunks_[i]));
+            }
+        }
+        chunks_.clear();
+        large_chunks_.clear();
+        next_ = nullptr;
+        remaining_ = 0;
+        used_ = 0;
+        reserved_ = 0;
+    }
+};
+
+}   // namespace neroll::script::detail
+
+#endif
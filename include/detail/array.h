@@ -17,6 +17,8 @@ namespace detail {
 class array;
 using value_t = std::variant<int32_t, double, bool, std::string, char, array>;
 
+// a handle to the elements, copies share them until one of the copies
+// changes them, e.g. every evaluation of a constant array literal
 class array {
  public:
     using size_type = std::vector<value_t>::size_type;
@@ -44,20 +46,34 @@ class array {
         return elem_type_;
     }
 
+    void reserve(size_type capacity) {
+        detach();
+        data_->reserve(capacity);
+    }
+
     void push_back(value_t value) {
+        detach();
         data_->emplace_back(std::move(value));
     }
 
     const value_t &operator[](std::size_t index) const noexcept {
         return data_->operator[](index);
     }
-    value_t &operator[](std::size_t index) noexcept {
+    value_t &operator[](std::size_t index) {
+        detach();
         return data_->operator[](index);
     }
 
  private:
     std::shared_ptr<std::vector<value_t>> data_;
     variable_type elem_type_;
+
+    // the elements of this handle only, before they are changed
+    void detach() {
+        if (data_.use_count() > 1) {
+            data_ = std::make_shared<std::vector<value_t>>(*data_);
+        }
+    }
 };
 
 }
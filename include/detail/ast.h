@@ -3,15 +3,23 @@
 
 #include <cstdint>
 #include <limits>
+#include <memory>   // shared_ptr
 #include <optional> // optional
+#include <string_view>  // string_view
+#include <unordered_map>    // unordered_map
 #include <variant>  // variant, get
 #include <string>   // string
-#include <memory>   // shared_ptr
+#include <span>     // span
 #include <concepts> // is_same_v
+#include <algorithm>    // all_of, copy
+#include <charconv>     // to_chars
 #include <cassert>  // assert
 #include <utility>  // pair
+#include <vector>   // vector
 
+#include "arena.h"
 #include "array.h"
+#include "position_t.h"
 #include "variable.h"
 #include "exception.h"
 #include "operator.h"
@@ -31,9 +39,30 @@ constexpr static void static_type_check() {
         std::is_same_v<T, array>);
 }
 
+// what a node is, for passes that walk the tree without evaluating it
+enum class node_kind : std::uint8_t {
+    // binary expressions
+    add, minus, multiply, divide, modulus,
+    logical_and, logical_or, bit_and, bit_or, bit_xor, shift_left, shift_right,
+    less, less_equal, greater, greater_equal, equal, not_equal,
+    // unary expressions
+    negative, logical_not, bit_not, type_cast,
+    array_value, array,
+    int_literal, float_literal, boolean_literal, string_literal, char_literal,
+    function_call, array_literal, interpolation,
+    // statements
+    expr_statement, for_statement, while_statement, continue_statement,
+    break_statement, return_statement, block, function_declaration
+};
+
+// nodes are made in an arena, which owns them, so children are plain
+// pointers
 class ast_node {
  public:
     virtual ~ast_node() = default;
+
+    [[nodiscard]]
+    virtual node_kind kind() const noexcept = 0;
 };
 
 class expr_node : public ast_node {
@@ -66,7 +95,12 @@ class expr_node : public ast_node {
         return std::get<T>(value_);
     }
 
-    virtual void evaluate() = 0;
+    // evaluates the operands, then this node, with a work stack rather
+    // than recursion, so deep trees do not overflow the native stack
+    void evaluate();
+
+    // sets the value from the operands, which are already evaluated
+    virtual void compute() = 0;
 
     [[nodiscard]]
     variable_type eval_type() const {
@@ -80,18 +114,18 @@ class expr_node : public ast_node {
 class binary_expr_node : public expr_node {
  public:
     binary_expr_node(
-        std::shared_ptr<expr_node> lhs, std::shared_ptr<expr_node> rhs
-    ) : lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+        expr_node *lhs, expr_node *rhs
+    ) : lhs_(lhs), rhs_(rhs) {}
 
     virtual ~binary_expr_node() = default;
 
     [[nodiscard]]
-    std::shared_ptr<expr_node> lhs() const noexcept {
+    expr_node *lhs() const noexcept {
         return lhs_;
     }
 
     [[nodiscard]]
-    std::shared_ptr<expr_node> rhs() const noexcept {
+    expr_node *rhs() const noexcept {
         return rhs_;
     }
 
@@ -105,14 +139,14 @@ class binary_expr_node : public expr_node {
     }
 
  private:
-    std::shared_ptr<expr_node> lhs_;
-    std::shared_ptr<expr_node> rhs_;
+    expr_node *lhs_;
+    expr_node *rhs_;
 };
 
 class binary_arithmetic_node : public binary_expr_node {
  public:
-    binary_arithmetic_node(std::shared_ptr<expr_node> lhs , std::shared_ptr<expr_node> rhs)
-        : binary_expr_node(std::move(lhs), std::move(rhs)) {}
+    binary_arithmetic_node(expr_node *lhs , expr_node *rhs)
+        : binary_expr_node(lhs, rhs) {}
     
     template <typename Operator>
     void int_int() {
@@ -143,12 +177,18 @@ class binary_arithmetic_node : public binary_expr_node {
 
 class add_node final : public binary_arithmetic_node {
  public:
-    add_node(std::shared_ptr<expr_node> left , std::shared_ptr<expr_node> right)
-        : binary_arithmetic_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::add;
+    }
+
+    add_node(expr_node *left , expr_node *right)
+        : binary_arithmetic_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
         if (is_both_string(lhs_type, rhs_type)) {
+            set_value(std::string{});
             return;
         }
 
@@ -179,10 +219,7 @@ class add_node final : public binary_arithmetic_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = binary_arithmetic_node;
 
         // cannot be constexpr because MSVC will make pointers incorrect
@@ -218,8 +255,13 @@ class add_node final : public binary_arithmetic_node {
 
 class minus_node final : public binary_arithmetic_node {
  public:
-    minus_node(std::shared_ptr<expr_node> left , std::shared_ptr<expr_node> right)
-        : binary_arithmetic_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::minus;
+    }
+
+    minus_node(expr_node *left , expr_node *right)
+        : binary_arithmetic_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -228,10 +270,7 @@ class minus_node final : public binary_arithmetic_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = binary_arithmetic_node;
 
         const static std::array<std::array<void(binary_arithmetic_node::*)(), 2>, 2> table {{
@@ -255,8 +294,13 @@ class minus_node final : public binary_arithmetic_node {
 
 class multiply_node final : public binary_arithmetic_node {
  public:
-    multiply_node(std::shared_ptr<expr_node> left , std::shared_ptr<expr_node> right)
-        : binary_arithmetic_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::multiply;
+    }
+
+    multiply_node(expr_node *left , expr_node *right)
+        : binary_arithmetic_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -287,10 +331,7 @@ class multiply_node final : public binary_arithmetic_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = binary_arithmetic_node;
 
         const static std::array<std::array<void(binary_arithmetic_node::*)(), 2>, 2> table {{
@@ -315,8 +356,13 @@ class multiply_node final : public binary_arithmetic_node {
 
 class divide_node final : public binary_arithmetic_node {
  public:
-    divide_node(std::shared_ptr<expr_node> left , std::shared_ptr<expr_node> right)
-        : binary_arithmetic_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::divide;
+    }
+
+    divide_node(expr_node *left , expr_node *right)
+        : binary_arithmetic_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -347,10 +393,7 @@ class divide_node final : public binary_arithmetic_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         if (rhs()->eval_type() == variable_type::integer) {
             if (rhs()->get<int32_t>() == 0) {
                 throw_execute_error("division by zero");
@@ -384,8 +427,13 @@ class divide_node final : public binary_arithmetic_node {
 
 class modulus_node final : public binary_arithmetic_node {
  public:
-    modulus_node(std::shared_ptr<expr_node> left , std::shared_ptr<expr_node> right)
-        : binary_arithmetic_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::modulus;
+    }
+
+    modulus_node(expr_node *left , expr_node *right)
+        : binary_arithmetic_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -394,18 +442,20 @@ class modulus_node final : public binary_arithmetic_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         int_int<modulus>();
     }
 };
 
 class logical_and_node : public binary_expr_node {
  public:
-    logical_and_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::logical_and;
+    }
+
+    logical_and_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -415,23 +465,26 @@ class logical_and_node : public binary_expr_node {
         set_value(bool{});
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        bool lhs_value = lhs()->get<bool>();
-        if (!lhs_value) {
-            set_value(false);
-        } else {
-            rhs()->evaluate();
-            bool rhs_value = rhs()->get<bool>();
-            set_value(lhs_value && rhs_value);
-        }
+    // the right side is evaluated only when the left one is true
+    [[nodiscard]]
+    bool needs_rhs() const {
+        return lhs()->get<bool>();
+    }
+
+    void compute() override {
+        set_value(needs_rhs() && rhs()->get<bool>());
     }
 };
 
 class logical_or_node : public binary_expr_node {
  public:
-    logical_or_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::logical_or;
+    }
+
+    logical_or_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -441,23 +494,26 @@ class logical_or_node : public binary_expr_node {
         set_value(bool{});
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        bool lhs_value = lhs()->get<bool>();
-        if (lhs_value) {
-            set_value(true);
-        } else {
-            rhs()->evaluate();
-            bool rhs_value = rhs()->get<bool>();
-            set_value(lhs_value || rhs_value);
-        }
+    // the right side is evaluated only when the left one is false
+    [[nodiscard]]
+    bool needs_rhs() const {
+        return !lhs()->get<bool>();
+    }
+
+    void compute() override {
+        set_value(!needs_rhs() || rhs()->get<bool>());
     }
 };
 
 class bit_and_node : public binary_expr_node {
  public:
-    explicit bit_and_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::bit_and;
+    }
+
+    explicit bit_and_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -467,10 +523,7 @@ class bit_and_node : public binary_expr_node {
         set_value(int32_t{});
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         auto lhs_value = lhs()->get<int32_t>();
         auto rhs_value = rhs()->get<int32_t>();
         set_value(lhs_value & rhs_value);
@@ -479,8 +532,13 @@ class bit_and_node : public binary_expr_node {
 
 class bit_or_node : public binary_expr_node {
  public:
-    explicit bit_or_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::bit_or;
+    }
+
+    explicit bit_or_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -490,10 +548,7 @@ class bit_or_node : public binary_expr_node {
         set_value(int32_t{});
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         auto lhs_value = lhs()->get<int32_t>();
         auto rhs_value = rhs()->get<int32_t>();
         set_value(lhs_value | rhs_value);
@@ -502,8 +557,13 @@ class bit_or_node : public binary_expr_node {
 
 class bit_xor_node : public binary_expr_node {
  public:
-    explicit bit_xor_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::bit_xor;
+    }
+
+    explicit bit_xor_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -513,10 +573,7 @@ class bit_xor_node : public binary_expr_node {
         set_value(int32_t{});
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         auto lhs_value = lhs()->get<int32_t>();
         auto rhs_value = rhs()->get<int32_t>();
         set_value(lhs_value ^ rhs_value);
@@ -525,8 +582,13 @@ class bit_xor_node : public binary_expr_node {
 
 class shift_left_node : public binary_expr_node {
  public:
-    explicit shift_left_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::shift_left;
+    }
+
+    explicit shift_left_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -535,10 +597,7 @@ class shift_left_node : public binary_expr_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         auto lhs_value = lhs()->get<int32_t>();
         auto rhs_value = rhs()->get<int32_t>();
 
@@ -552,8 +611,13 @@ class shift_left_node : public binary_expr_node {
 
 class shift_right_node : public binary_expr_node {
  public:
-    explicit shift_right_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : binary_expr_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::shift_right;
+    }
+
+    explicit shift_right_node(expr_node *left, expr_node *right)
+        : binary_expr_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
 
@@ -562,10 +626,7 @@ class shift_right_node : public binary_expr_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         auto lhs_value = lhs()->get<int32_t>();
         auto rhs_value = rhs()->get<int32_t>();
 
@@ -579,8 +640,8 @@ class shift_right_node : public binary_expr_node {
 
 class relation_node : public binary_expr_node {
  public:
-    relation_node(std::shared_ptr<expr_node> lhs, std::shared_ptr<expr_node> rhs)
-        : binary_expr_node(std::move(lhs), std::move(rhs)) {
+    relation_node(expr_node *lhs, expr_node *rhs)
+        : binary_expr_node(lhs, rhs) {
         set_value(bool{});
     }
 
@@ -623,8 +684,13 @@ class relation_node : public binary_expr_node {
 
 class less_node : public relation_node {
  public:
-    less_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::less;
+    }
+
+    less_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -633,10 +699,7 @@ class less_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*      int                  float            boolean         string               char          */
@@ -659,8 +722,13 @@ class less_node : public relation_node {
 
 class less_equal_node : public relation_node {
  public:
-    less_equal_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::less_equal;
+    }
+
+    less_equal_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -669,10 +737,7 @@ class less_equal_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*          int                        float              boolean             string                    char          */
@@ -695,8 +760,13 @@ class less_equal_node : public relation_node {
 
 class greater_node : public relation_node {
  public:
-    greater_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::greater;
+    }
+
+    greater_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -705,10 +775,7 @@ class greater_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*       int                     float              boolean         string                      char          */
@@ -731,8 +798,13 @@ class greater_node : public relation_node {
 
 class greater_equal_node : public relation_node {
  public:
-    greater_equal_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::greater_equal;
+    }
+
+    greater_equal_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -741,10 +813,7 @@ class greater_equal_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*        int                              float                  boolean              string                       char           */
@@ -767,8 +836,13 @@ class greater_equal_node : public relation_node {
 
 class equal_node : public relation_node {
  public:
-    equal_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::equal;
+    }
+
+    equal_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -777,10 +851,7 @@ class equal_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*      int                   float                  boolean              string                char          */
@@ -803,8 +874,13 @@ class equal_node : public relation_node {
 
 class not_equal_node : public relation_node {
  public:
-    not_equal_node(std::shared_ptr<expr_node> left, std::shared_ptr<expr_node> right)
-        : relation_node(std::move(left), std::move(right)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::not_equal;
+    }
+
+    not_equal_node(expr_node *left, expr_node *right)
+        : relation_node(left, right) {
         variable_type lhs_type = lhs()->eval_type();
         variable_type rhs_type = rhs()->eval_type();
         variable_type result_type = binary_expr_type(lhs_type, token_type::less, rhs_type);
@@ -813,10 +889,7 @@ class not_equal_node : public relation_node {
         }
     }
 
-    void evaluate() override {
-        lhs()->evaluate();
-        rhs()->evaluate();
-
+    void compute() override {
         using a = relation_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table {{
              /*        int                       float                      boolean                 string                    char          */
@@ -839,24 +912,29 @@ class not_equal_node : public relation_node {
 
 class unary_node : public expr_node {
  public:
-    explicit unary_node(std::shared_ptr<expr_node> expr)
-        : expr_(std::move(expr)) {}
+    explicit unary_node(expr_node *expr)
+        : expr_(expr) {}
     
     virtual ~unary_node() = default;
     
     [[nodiscard]]
-    std::shared_ptr<expr_node> expr() const noexcept {
+    expr_node *expr() const noexcept {
         return expr_;
     }
 
  private:
-    std::shared_ptr<expr_node> expr_;
+    expr_node *expr_;
 };
 
 class negative_node : public unary_node {
  public:
-    explicit negative_node(std::shared_ptr<expr_node> exp)
-        : unary_node(std::move(exp)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::negative;
+    }
+
+    explicit negative_node(expr_node *exp)
+        : unary_node(exp) {
         if (expr()->eval_type() != variable_type::integer && expr()->eval_type() != variable_type::floating) {
             throw_type_error("invalid unary operator - for {}", expr()->eval_type());
         }
@@ -874,8 +952,7 @@ class negative_node : public unary_node {
         }
     }
 
-    void evaluate() override {
-        expr()->evaluate();
+    void compute() override {
         if (expr()->eval_type() == variable_type::integer) {
             set_value(-expr()->get<int32_t>());
         } else {
@@ -886,16 +963,20 @@ class negative_node : public unary_node {
 
 class logical_not_node : public unary_node {
  public:
-    explicit logical_not_node(std::shared_ptr<expr_node> exp)
-        : unary_node(std::move(exp)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::logical_not;
+    }
+
+    explicit logical_not_node(expr_node *exp)
+        : unary_node(exp) {
         if (expr()->eval_type() != variable_type::boolean) {
             throw_type_error("invalid unary operator ! for {}", expr()->eval_type());
         }
         set_value(bool{});
     }
 
-    void evaluate() override {
-        expr()->evaluate();
+    void compute() override {
         bool value = expr()->get<bool>();
         if (value) {
             set_value(false);
@@ -907,8 +988,13 @@ class logical_not_node : public unary_node {
 
 class bit_not_node : public unary_node {
  public:
-    explicit bit_not_node(std::shared_ptr<expr_node> exp)
-        : unary_node(std::move(exp)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::bit_not;
+    }
+
+    explicit bit_not_node(expr_node *exp)
+        : unary_node(exp) {
 
         if (expr()->eval_type() != variable_type::integer) {
             throw_type_error("invalid operator ~ for {}", expr()->eval_type());
@@ -916,8 +1002,7 @@ class bit_not_node : public unary_node {
         set_value(int32_t{});
     }
 
-    void evaluate() override {
-        expr()->evaluate();
+    void compute() override {
         auto value = expr()->get<int32_t>();
         set_value(~value);
     }
@@ -925,11 +1010,36 @@ class bit_not_node : public unary_node {
 
 class type_cast_node : public unary_node {
  public:
-    type_cast_node(std::shared_ptr<expr_node> exp, variable_type target_type)
-        : unary_node(std::move(exp)), target_type_(target_type) {}
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::type_cast;
+    }
+
+    type_cast_node(expr_node *exp, variable_type target_type)
+        : unary_node(exp), target_type_(target_type) {
+        // typed before the first evaluation, e.g. as an element of a literal
+        switch (target_type_) {
+            case variable_type::integer:
+                set_value(int32_t{});
+                break;
+            case variable_type::floating:
+                set_value(double{});
+                break;
+            case variable_type::boolean:
+                set_value(bool{});
+                break;
+            case variable_type::string:
+                set_value(std::string{});
+                break;
+            case variable_type::character:
+                set_value(char{});
+                break;
+            default:
+                std::unreachable();
+        }
+    }
 
-    void evaluate() override {
-        expr()->evaluate();
+    void compute() override {
         variable_type original_type = expr()->eval_type();
         using a = type_cast_node;
         const static std::array<std::array<void(a::*)(), 5>, 5> table{{
@@ -955,6 +1065,11 @@ class type_cast_node : public unary_node {
         (this->*table[l_index][r_index])();
     }
 
+    [[nodiscard]]
+    variable_type target_type() const noexcept {
+        return target_type_;
+    }
+
     template <typename OriginType, typename TargetType>
     void type_cast() {
         auto value = expr()->get<OriginType>();
@@ -967,8 +1082,13 @@ class type_cast_node : public unary_node {
 
 class array_value_node : public expr_node {
  public:
-    array_value_node(std::shared_ptr<expr_node> array, std::shared_ptr<expr_node> index)
-        : array_node(std::move(array)), index_node(std::move(index)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::array_value;
+    }
+
+    array_value_node(expr_node *array, expr_node *index)
+        : array_node(array), index_node(index) {
         if (array_node->eval_type() != variable_type::array) {
             throw_type_error("invalid operator [] for {}", array_node->eval_type());
         }
@@ -993,53 +1113,82 @@ class array_value_node : public expr_node {
             case variable_type::character:
                 set_value(char{});
                 break;
-            case variable_type::array:
-                
-                set_value(detail::array{variable_type::array});
+            case variable_type::array: {
+                // the first element stands for all of them, so indexing it
+                // again has the right type
+                const detail::array &elements = array_node->get<detail::array>();
+                set_value(elements.empty() ? value_t{detail::array{variable_type::array}} : elements[0]);
                 break;
+            }
             default:
                 std::unreachable();
         }
     }
     
-    void evaluate() override {
-        array_node->evaluate();
-        index_node->evaluate();
-        
-        auto arr = array_node->get<array>();
+    void compute() override {
+        // a const view, so a shared array is not copied
+        const array &arr = array_node->get<array>();
         auto index = index_node->get<int32_t>();
 
-        if (index < 0 || index > arr.size()) {
+        if (index < 0 || index >= arr.size()) {
             throw_execute_error("index {} out of bounds: array size is {}", index, arr.size());
         }
 
         set_value(arr[index]);
     }
 
+    [[nodiscard]]
+    expr_node *array_expr() const noexcept {
+        return array_node;
+    }
+
+    [[nodiscard]]
+    expr_node *index_expr() const noexcept {
+        return index_node;
+    }
+
  private:
-    std::shared_ptr<expr_node> array_node;
-    std::shared_ptr<expr_node> index_node;
+    expr_node *array_node;
+    expr_node *index_node;
 };
 
 class array_node : public expr_node {
  public:
-    array_node(variable_type type, std::vector<std::shared_ptr<expr_node>> sizes)
-        : elem_type(type), size_per_dim(std::move(sizes)) {
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::array;
+    }
+
+    array_node(variable_type type, std::span<expr_node *const> sizes)
+        : elem_type(type), size_per_dim(sizes) {
         assert(!size_per_dim.empty());
-        if (size_per_dim.size() == 1) {
-            set_value(array{elem_type});
-        } else {
-            set_value(array{variable_type::array});
+        // one empty array per inner dimension, for the type of an element
+        array prototype{elem_type};
+        for (std::size_t i = 1; i < size_per_dim.size(); i++) {
+            array outer{variable_type::array};
+            outer.push_back(std::move(prototype));
+            prototype = std::move(outer);
         }
+        set_value(std::move(prototype));
     }
 
-    void evaluate() override {
+    void compute() override {
         set_value(build_array(0));
     }
 
+    [[nodiscard]]
+    variable_type element_type() const noexcept {
+        return elem_type;
+    }
+
+    [[nodiscard]]
+    std::span<expr_node *const> sizes() const noexcept {
+        return size_per_dim;
+    }
+
  private:
     variable_type elem_type;
-    std::vector<std::shared_ptr<expr_node>> size_per_dim;
+    std::span<expr_node *const> size_per_dim;
 
     array build_array(std::size_t dimension) {
         assert(!size_per_dim.empty());
@@ -1089,47 +1238,243 @@ class array_node : public expr_node {
 
 class int_node : public expr_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::int_literal;
+    }
+
     explicit int_node(int32_t value) {
         set_value(value);
     }
 
-    void evaluate() override {}
+    void compute() override {}
 };
 
 class float_node : public expr_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::float_literal;
+    }
+
     explicit float_node(double value) {
         set_value(value);
     }
 
-    void evaluate() override {}
+    void compute() override {}
 };
 
 class boolean_node : public expr_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::boolean_literal;
+    }
+
     explicit boolean_node(bool value) {
         set_value(value);
     }
 
-    void evaluate() override {}
+    void compute() override {}
 };
 
 class string_node : public expr_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::string_literal;
+    }
+
     explicit string_node(std::string str) {
         set_value(std::move(str));
     }
 
-    void evaluate() override {}
+    void compute() override {}
 };
 
 class char_node : public expr_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::char_literal;
+    }
+
     explicit char_node(char value) {
         set_value(value);
     }
 
-    void evaluate() override {}
+    void compute() override {}
+};
+
+// {a, b, ...}, when all elements are literals, or literals of their own,
+// the array is built once, when the node is made, and evaluating the node
+// only hands out another handle to it
+class array_literal_node : public expr_node {
+ public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::array_literal;
+    }
+
+    array_literal_node(std::span<expr_node *const> elements)
+        : elements_(elements) {
+        if (elements_.empty()) {
+            throw_type_error("array literal must have elements");
+        }
+        const variable_type type = elements_[0]->eval_type();
+        for (const expr_node *element : elements_) {
+            if (element->eval_type() != type) {
+                throw_type_error("array literal elements must be {}, found {}", type, element->eval_type());
+            }
+        }
+        constant_ = std::ranges::all_of(elements_, is_constant);
+        // otherwise the first element stands for all of them
+        array arr{type};
+        for (const expr_node *element : constant_ ? elements_ : elements_.first(1)) {
+            arr.push_back(element->value());
+        }
+        set_value(std::move(arr));
+    }
+
+    void compute() override {
+        if (constant_) {
+            return;
+        }
+        array arr{element_type()};
+        arr.reserve(elements_.size());
+        for (const expr_node *element : elements_) {
+            arr.push_back(element->value());
+        }
+        set_value(std::move(arr));
+    }
+
+    [[nodiscard]]
+    std::span<expr_node *const> elements() const noexcept {
+        return elements_;
+    }
+
+    [[nodiscard]]
+    variable_type element_type() const noexcept {
+        return elements_[0]->eval_type();
+    }
+
+    // built when the node was made, the elements are not evaluated
+    [[nodiscard]]
+    bool constant() const noexcept {
+        return constant_;
+    }
+
+ private:
+    std::span<expr_node *const> elements_;
+    bool constant_ = false;
+
+    static bool is_constant(const expr_node *node) noexcept {
+        switch (node->kind()) {
+            case node_kind::int_literal:
+            case node_kind::float_literal:
+            case node_kind::boolean_literal:
+            case node_kind::string_literal:
+            case node_kind::char_literal:
+                return true;
+            case node_kind::array_literal:
+                return static_cast<const array_literal_node *>(node)->constant();
+            default:
+                return false;
+        }
+    }
+};
+
+// $"text {expression} text", the text around the holes was split out when
+// parsing, the result is formatted into one buffer sized up front
+class interpolation_node : public expr_node {
+ public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::interpolation;
+    }
+
+    // one more text than holes, the text before each hole and after the last
+    interpolation_node(std::span<const std::string_view> texts, std::span<expr_node *const> holes)
+        : texts_(texts), holes_(holes) {
+        assert(texts_.size() == holes_.size() + 1);
+        for (const expr_node *hole : holes_) {
+            if (hole->eval_type() == variable_type::array) {
+                throw_type_error("cannot interpolate {}", hole->eval_type());
+            }
+        }
+        set_value(std::string{});
+    }
+
+    void compute() override {
+        std::size_t size = 0;
+        for (std::string_view text : texts_) {
+            size += text.size();
+        }
+        for (const expr_node *hole : holes_) {
+            size += formatted_size(*hole);
+        }
+        std::string result;
+        result.resize_and_overwrite(size, [this](char *buffer, std::size_t capacity) {
+            char *out = std::ranges::copy(texts_[0], buffer).out;
+            for (std::size_t i = 0; i < holes_.size(); i++) {
+                out = format(*holes_[i], out, buffer + capacity);
+                out = std::ranges::copy(texts_[i + 1], out).out;
+            }
+            return static_cast<std::size_t>(out - buffer);
+        });
+        set_value(std::move(result));
+    }
+
+    [[nodiscard]]
+    std::span<const std::string_view> texts() const noexcept {
+        return texts_;
+    }
+
+    [[nodiscard]]
+    std::span<expr_node *const> holes() const noexcept {
+        return holes_;
+    }
+
+ private:
+    std::span<const std::string_view> texts_;
+    std::span<expr_node *const> holes_;
+
+    // room for the text of a hole, exact for strings, an upper bound for
+    // numbers, which std::to_chars writes in their shortest form
+    static std::size_t formatted_size(const expr_node &hole) {
+        switch (hole.eval_type()) {
+            case variable_type::integer:
+                return std::numeric_limits<int32_t>::digits10 + 2;
+            case variable_type::floating:
+                return 32;
+            case variable_type::boolean:
+                return 5;
+            case variable_type::string:
+                return hole.get<std::string>().size();
+            case variable_type::character:
+                return 1;
+            default:
+                std::unreachable();
+        }
+    }
+
+    static char *format(const expr_node &hole, char *out, char *end) {
+        switch (hole.eval_type()) {
+            case variable_type::integer:
+                return std::to_chars(out, end, hole.get<int32_t>()).ptr;
+            case variable_type::floating:
+                return std::to_chars(out, end, hole.get<double>()).ptr;
+            case variable_type::boolean:
+                return std::ranges::copy(std::string_view{hole.get<bool>() ? "true" : "false"}, out).out;
+            case variable_type::string:
+                return std::ranges::copy(hole.get<std::string>(), out).out;
+            case variable_type::character:
+                *out = hole.get<char>();
+                return out + 1;
+            default:
+                std::unreachable();
+        }
+    }
 };
 
 // class array_node : public expr_node {
@@ -1185,8 +1530,19 @@ class statement_node : public ast_node {
 
 class expr_stat_node : public statement_node, public expr_node {
  public:
-    expr_stat_node(std::shared_ptr<expr_node> expr)
-        : expr_(std::move(expr)) {}
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::expr_statement;
+    }
+
+    expr_stat_node(expr_node *expr)
+        : expr_(expr) {}
+
+    // null for an empty statement
+    [[nodiscard]]
+    expr_node *expr() const noexcept {
+        return expr_;
+    }
     
     std::pair<execute_state, std::optional<value_t>> execute() override {
         if (expr_) {
@@ -1195,24 +1551,29 @@ class expr_stat_node : public statement_node, public expr_node {
         return {execute_state::normal, std::nullopt};
     }
 
-    void evaluate() override {
+    void compute() override {
         if (expr_) {
             expr_->evaluate();
         }
     }
 
  private:
-    std::shared_ptr<expr_node> expr_;
+    expr_node *expr_;
 };
 
 class for_node : public statement_node {
  public:
-    for_node(std::shared_ptr<expr_stat_node> init,
-             std::shared_ptr<expr_stat_node> condition,
-             std::shared_ptr<expr_node>      update,
-             std::shared_ptr<statement_node> statements)
-        : init_(std::move(init)), condition_(std::move(condition)),
-          update_(std::move(update)), statements_(std::move(statements)) {}
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::for_statement;
+    }
+
+    for_node(expr_stat_node *init,
+             expr_stat_node *condition,
+             expr_node      *update,
+             statement_node *statements)
+        : init_(init), condition_(condition),
+          update_(update), statements_(statements) {}
 
     std::pair<execute_state, std::optional<value_t>> execute() override {
         assert(condition_->eval_type() == variable_type::boolean);
@@ -1238,16 +1599,21 @@ class for_node : public statement_node {
     }
 
  private:
-    std::shared_ptr<expr_stat_node> init_;
-    std::shared_ptr<expr_stat_node> condition_;
-    std::shared_ptr<expr_node>      update_;
-    std::shared_ptr<statement_node> statements_;
+    expr_stat_node *init_;
+    expr_stat_node *condition_;
+    expr_node      *update_;
+    statement_node *statements_;
 };
 
 class while_node : public statement_node {
  public:
-    while_node(std::shared_ptr<expr_node> condition, std::shared_ptr<statement_node> body)
-        : condition_(std::move(condition)), body_(std::move(body)) {}
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::while_statement;
+    }
+
+    while_node(expr_node *condition, statement_node *body)
+        : condition_(condition), body_(body) {}
 
     std::pair<execute_state, std::optional<value_t>> execute() override {
         assert(condition_->eval_type() == variable_type::boolean);
@@ -1269,12 +1635,17 @@ class while_node : public statement_node {
     }
 
  private:
-    std::shared_ptr<expr_node> condition_;
-    std::shared_ptr<statement_node> body_;
+    expr_node *condition_;
+    statement_node *body_;
 };
 
 class continue_node : public statement_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::continue_statement;
+    }
+
     std::pair<execute_state, std::optional<value_t>> execute() override {
         return {execute_state::continued, std::nullopt};
     }
@@ -1282,6 +1653,11 @@ class continue_node : public statement_node {
 
 class break_node : public statement_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::break_statement;
+    }
+
     std::pair<execute_state, std::optional<value_t>> execute() override {
         return {execute_state::broken, std::nullopt};
     }
@@ -1289,9 +1665,14 @@ class break_node : public statement_node {
 
 class return_node : public statement_node {
  public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::return_statement;
+    }
+
     // pass `nullptr` to return void
-    return_node(std::shared_ptr<expr_node> expr)
-        : expr_(std::move(expr)) {}
+    return_node(expr_node *expr)
+        : expr_(expr) {}
 
     std::pair<execute_state, std::optional<value_t>> execute() override {
         if (expr_ == nullptr) {
@@ -1301,14 +1682,29 @@ class return_node : public statement_node {
         return {execute_state::returned, expr_->value()};
     }
 
+    [[nodiscard]]
+    expr_node *expr() const noexcept {
+        return expr_;
+    }
+
  private:
-    std::shared_ptr<expr_node> expr_;
+    expr_node *expr_;
 };
 
 class block_node : public statement_node {
  public:
-    explicit block_node(std::vector<std::shared_ptr<statement_node>> statements)
-        : statements_(std::move(statements)) {}
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::block;
+    }
+
+    explicit block_node(std::span<statement_node *const> statements)
+        : statements_(statements) {}
+
+    [[nodiscard]]
+    std::span<statement_node *const> statements() const noexcept {
+        return statements_;
+    }
 
     std::pair<execute_state, std::optional<value_t>> execute() override {
         for (auto &statement : statements_) {
@@ -1320,9 +1716,270 @@ class block_node : public statement_node {
         return {execute_state::normal, std::nullopt};
     }
  private:
-    std::vector<std::shared_ptr<statement_node>> statements_;
+    std::span<statement_node *const> statements_;
+};
+
+class function_node;
+
+// functions of a script by name, a function sees those declared before it
+// and itself
+using function_table = std::unordered_map<std::string_view, function_node *>;
+
+class function_node : public statement_node {
+ public:
+    // parses a deferred body, on the first call of the function
+    using body_parser = statement_node *(*)(function_node &);
+
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::function_declaration;
+    }
+
+    function_node(std::string_view name, std::span<const variable_type> parameters,
+                  variable_type return_type, function_table *functions, std::size_t index)
+        : name_(name), parameters_(parameters), return_type_(return_type),
+          functions_(functions), index_(index) {}
+
+    // declaring a function runs nothing
+    std::pair<execute_state, std::optional<value_t>> execute() override {
+        return {execute_state::normal, std::nullopt};
+    }
+
+    [[nodiscard]]
+    std::string_view name() const noexcept {
+        return name_;
+    }
+
+    [[nodiscard]]
+    std::span<const variable_type> parameters() const noexcept {
+        return parameters_;
+    }
+
+    [[nodiscard]]
+    variable_type return_type() const noexcept {
+        return return_type_;
+    }
+
+    [[nodiscard]]
+    function_table *functions() const noexcept {
+        return functions_;
+    }
+
+    // position among the functions of the script
+    [[nodiscard]]
+    std::size_t index() const noexcept {
+        return index_;
+    }
+
+    // parsed on the first call when the body was deferred
+    statement_node *body() {
+        if (body_ == nullptr) {
+            body_ = parse_body_(*this);
+            body_context_.reset();
+        }
+        return body_;
+    }
+
+    [[nodiscard]]
+    bool parsed() const noexcept {
+        return body_ != nullptr;
+    }
+
+    // source text of a deferred body, braces included
+    [[nodiscard]]
+    std::string_view body_text() const noexcept {
+        return body_text_;
+    }
+
+    // where the deferred body starts in the source
+    [[nodiscard]]
+    const position_t &body_position() const noexcept {
+        return body_position_;
+    }
+
+    // what the parser of a deferred body needs besides its text
+    [[nodiscard]]
+    const std::shared_ptr<void> &body_context() const noexcept {
+        return body_context_;
+    }
+
+    // `nodes` is where the body was made when it is not the arena of the
+    // function itself
+    void define(statement_node *body, std::shared_ptr<arena> nodes = nullptr) noexcept {
+        body_ = body;
+        body_nodes_ = std::move(nodes);
+    }
+
+    // `context` is kept until the body is parsed, e.g. the options of the
+    // parser that deferred it
+    void defer(std::string_view text, const position_t &position, body_parser parse_body,
+               std::shared_ptr<void> context = nullptr) noexcept {
+        body_text_ = text;
+        body_position_ = position;
+        parse_body_ = parse_body;
+        body_context_ = std::move(context);
+    }
+
+ private:
+    std::string_view name_;
+    std::span<const variable_type> parameters_;
+    variable_type return_type_;
+    function_table *functions_;
+    std::size_t index_;
+    statement_node *body_ = nullptr;
+    std::string_view body_text_;
+    position_t body_position_;
+    body_parser parse_body_ = nullptr;
+    std::shared_ptr<void> body_context_;
+    std::shared_ptr<arena> body_nodes_;
 };
 
+// arguments were checked against the parameters when the call was parsed,
+// they are evaluated but not bound, since the language has no variables yet
+class function_call_node : public expr_node {
+ public:
+    [[nodiscard]]
+    node_kind kind() const noexcept override {
+        return node_kind::function_call;
+    }
+
+    function_call_node(function_node *function, std::span<expr_node *const> arguments)
+        : function_(function), arguments_(arguments) {
+        switch (function_->return_type()) {
+            case variable_type::integer:
+                set_value(int32_t{});
+                break;
+            case variable_type::floating:
+                set_value(double{});
+                break;
+            case variable_type::boolean:
+                set_value(bool{});
+                break;
+            case variable_type::string:
+                set_value(std::string{});
+                break;
+            case variable_type::character:
+                set_value(char{});
+                break;
+            default:
+                std::unreachable();
+        }
+    }
+
+    // how deep calls nest, each call takes native stack for its body
+    constexpr static std::size_t max_call_depth = 1'000;
+
+    void compute() override {
+        thread_local std::size_t depth = 0;
+        if (depth == max_call_depth) {
+            throw_execute_error("calls nested deeper than {} levels in function '{}'", max_call_depth, function_->name());
+        }
+        depth++;
+        struct leave {
+            ~leave() {
+                depth--;
+            }
+        } guard;
+        auto [state, returned] = function_->body()->execute();
+        if (!returned) {
+            throw_execute_error("function '{}' ended without returning a value", function_->name());
+        }
+        set_value(std::move(*returned));
+    }
+
+    [[nodiscard]]
+    function_node *function() const noexcept {
+        return function_;
+    }
+
+    [[nodiscard]]
+    std::span<expr_node *const> arguments() const noexcept {
+        return arguments_;
+    }
+
+ private:
+    function_node *function_;
+    std::span<expr_node *const> arguments_;
+};
+
+// the operand of `node` evaluated `index`-th, null once there is none, the
+// right side of && and || is skipped when the left one decides the value
+inline expr_node *next_operand(expr_node *node, std::size_t index) {
+    auto binary_operand = [index](expr_node *binary_node) {
+        auto *binary = static_cast<binary_expr_node *>(binary_node);
+        return index == 0 ? binary->lhs() : index == 1 ? binary->rhs() : nullptr;
+    };
+    switch (node->kind()) {
+        case node_kind::logical_and:
+            if (index == 1 && !static_cast<logical_and_node *>(node)->needs_rhs()) {
+                return nullptr;
+            }
+            return binary_operand(node);
+        case node_kind::logical_or:
+            if (index == 1 && !static_cast<logical_or_node *>(node)->needs_rhs()) {
+                return nullptr;
+            }
+            return binary_operand(node);
+        case node_kind::add: case node_kind::minus: case node_kind::multiply:
+        case node_kind::divide: case node_kind::modulus:
+        case node_kind::bit_and: case node_kind::bit_or: case node_kind::bit_xor:
+        case node_kind::shift_left: case node_kind::shift_right:
+        case node_kind::less: case node_kind::less_equal: case node_kind::greater:
+        case node_kind::greater_equal: case node_kind::equal: case node_kind::not_equal:
+            return binary_operand(node);
+        case node_kind::negative: case node_kind::logical_not:
+        case node_kind::bit_not: case node_kind::type_cast:
+            return index == 0 ? static_cast<unary_node *>(node)->expr() : nullptr;
+        case node_kind::array_value: {
+            auto *element = static_cast<array_value_node *>(node);
+            return index == 0 ? element->array_expr() : index == 1 ? element->index_expr() : nullptr;
+        }
+        case node_kind::function_call: {
+            auto arguments = static_cast<function_call_node *>(node)->arguments();
+            return index < arguments.size() ? arguments[index] : nullptr;
+        }
+        case node_kind::interpolation: {
+            auto holes = static_cast<interpolation_node *>(node)->holes();
+            return index < holes.size() ? holes[index] : nullptr;
+        }
+        case node_kind::array_literal: {
+            auto *literal = static_cast<array_literal_node *>(node);
+            return !literal->constant() && index < literal->elements().size() ? literal->elements()[index] : nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+// a node is computed once all its operands are, the stack holds the path
+// from the root to the node being visited, with the next operand of each;
+// nested calls, from function bodies and array sizes, share the stack above
+// the frames of their caller
+inline void expr_node::evaluate() {
+    struct frame {
+        expr_node *node;
+        std::size_t next;
+    };
+    thread_local std::vector<frame> stack;
+    const std::size_t base = stack.size();
+    stack.push_back({this, 0});
+    try {
+        while (stack.size() > base) {
+            frame &top = stack.back();
+            if (expr_node *operand = next_operand(top.node, top.next)) {
+                top.next++;
+                stack.push_back({operand, 0});
+            } else {
+                top.node->compute();
+                stack.pop_back();
+            }
+        }
+    } catch (...) {
+        stack.resize(base);
+        throw;
+    }
+}
+
 }   // namespace detail
 
 }   // namespace script
@@ -0,0 +1,630 @@
+#ifndef NEROLL_SCRIPT_DETAIL_FLAT_AST_H
+#define NEROLL_SCRIPT_DETAIL_FLAT_AST_H
+
+#include <bit>          // bit_cast
+#include <cassert>      // assert
+#include <cstddef>      // size_t
+#include <cstdint>      // int32_t, uint32_t
+#include <functional>   // hash
+#include <limits>       // numeric_limits
+#include <memory>       // shared_ptr
+#include <optional>     // optional
+#include <span>         // span
+#include <string>       // string
+#include <type_traits>  // is_same_v, remove_cvref_t
+#include <unordered_map>  // unordered_map
+#include <utility>      // pair, move
+#include <variant>      // visit, get, bad_variant_access
+#include <vector>       // vector
+
+#include "array.h"      // array, value_t
+#include "ast.h"        // expr_node, node_kind
+#include "exception.h"  // throw_execute_error, throw_type_error
+#include "operator.h"   // plus, less, ...
+
+namespace neroll::script::detail {
+
+// an expression tree laid out in post-order over parallel vectors, so
+// evaluating it walks memory mostly forwards, the last child of a node is
+// the node just before it and only the first child of a binary node needs
+// an index
+class flat_expression {
+ public:
+    using index_type = std::uint32_t;
+
+    explicit flat_expression(const expr_node &root) {
+        constant_map scalars;
+        lower(root, scalars);
+        kinds_ = kind_storage_;
+        operands_ = operand_storage_;
+        lists_ = list_storage_;
+    }
+
+    // a layout kept in memory owned by `image`, e.g. a mapped file, which
+    // must be checked with well_formed() before it is evaluated
+    flat_expression(std::span<const node_kind> kinds, std::span<const index_type> operands,
+                    std::span<const index_type> lists, std::vector<value_t> constants,
+                    std::shared_ptr<const void> image)
+        : kinds_(kinds), operands_(operands), lists_(lists),
+          constants_(std::move(constants)), image_(std::move(image)) {}
+
+    // the views point into the storage, whose buffers move along
+    flat_expression(const flat_expression&) = delete;
+    flat_expression& operator=(const flat_expression&) = delete;
+    flat_expression(flat_expression&&) = default;
+    flat_expression& operator=(flat_expression&&) = default;
+
+    [[nodiscard]]
+    value_t evaluate() const {
+        return evaluate(root());
+    }
+
+    [[nodiscard]]
+    index_type root() const noexcept {
+        assert(!kinds_.empty());
+        return static_cast<index_type>(kinds_.size() - 1);
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return kinds_.size();
+    }
+
+    [[nodiscard]]
+    node_kind kind(index_type index) const noexcept {
+        return kinds_[index];
+    }
+
+    [[nodiscard]]
+    index_type operand(index_type index) const noexcept {
+        return operands_[index];
+    }
+
+    [[nodiscard]]
+    const std::vector<value_t> &constants() const noexcept {
+        return constants_;
+    }
+
+    [[nodiscard]]
+    std::span<const node_kind> kinds() const noexcept {
+        return kinds_;
+    }
+
+    [[nodiscard]]
+    std::span<const index_type> operands() const noexcept {
+        return operands_;
+    }
+
+    [[nodiscard]]
+    std::span<const index_type> lists() const noexcept {
+        return lists_;
+    }
+
+    // whether every index stays in bounds and every child comes before its
+    // parent, so evaluate() terminates whatever the layout was read from
+    [[nodiscard]]
+    bool well_formed() const noexcept {
+        if (kinds_.empty() || kinds_.size() != operands_.size() ||
+            kinds_.size() > std::numeric_limits<index_type>::max()) {
+            return false;
+        }
+        for (index_type index = 0; index < kinds_.size(); index++) {
+            if (!well_formed(index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // memory taken by the layout, not counting what constants own
+    [[nodiscard]]
+    std::size_t bytes() const noexcept {
+        return kinds_.size() * sizeof(node_kind) + operands_.size() * sizeof(index_type) +
+               constants_.size() * sizeof(value_t) + lists_.size() * sizeof(index_type);
+    }
+
+ private:
+    std::span<const node_kind> kinds_;
+    // literals: index into constants_, binary nodes: the first child,
+    // casts: the target variable_type, new arrays: offset into lists_
+    std::span<const index_type> operands_;
+    // new arrays: element type, number of dimensions, then the index of
+    // the size of each dimension
+    std::span<const index_type> lists_;
+    // each distinct scalar literal once, strings as they appear
+    std::vector<value_t> constants_;
+
+    // what the views above point into, filled when lowering a tree or
+    // kept alive when the layout was read from an image
+    std::vector<node_kind> kind_storage_;
+    std::vector<index_type> operand_storage_;
+    std::vector<index_type> list_storage_;
+    std::shared_ptr<const void> image_;
+
+    index_type emit(node_kind kind, index_type operand) {
+        if (kind_storage_.size() == std::numeric_limits<index_type>::max()) {
+            throw_execute_error("expression has more than {} nodes", std::numeric_limits<index_type>::max());
+        }
+        kind_storage_.push_back(kind);
+        operand_storage_.push_back(operand);
+        return static_cast<index_type>(kind_storage_.size() - 1);
+    }
+
+    bool well_formed(index_type index) const noexcept {
+        const index_type operand = operands_[index];
+        switch (kinds_[index]) {
+            case node_kind::add:
+            case node_kind::minus:
+            case node_kind::multiply:
+            case node_kind::divide:
+            case node_kind::modulus:
+            case node_kind::logical_and:
+            case node_kind::logical_or:
+            case node_kind::bit_and:
+            case node_kind::bit_or:
+            case node_kind::bit_xor:
+            case node_kind::shift_left:
+            case node_kind::shift_right:
+            case node_kind::less:
+            case node_kind::less_equal:
+            case node_kind::greater:
+            case node_kind::greater_equal:
+            case node_kind::equal:
+            case node_kind::not_equal:
+            case node_kind::array_value:
+                return index >= 2 && operand < index - 1;
+            case node_kind::negative:
+            case node_kind::logical_not:
+            case node_kind::bit_not:
+                return index >= 1;
+            case node_kind::type_cast:
+                return index >= 1 && operand <= static_cast<index_type>(variable_type::array);
+            case node_kind::array: {
+                if (operand >= lists_.size() || lists_.size() - operand < 2) {
+                    return false;
+                }
+                const index_type elem_type = lists_[operand];
+                const index_type dimensions = lists_[operand + 1];
+                if (elem_type >= static_cast<index_type>(variable_type::array) || dimensions == 0 ||
+                    lists_.size() - operand - 2 < dimensions) {
+                    return false;
+                }
+                for (index_type i = 0; i < dimensions; i++) {
+                    if (lists_[operand + 2 + i] >= index) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case node_kind::int_literal:
+                return operand < constants_.size() && std::holds_alternative<int32_t>(constants_[operand]);
+            case node_kind::float_literal:
+                return operand < constants_.size() && std::holds_alternative<double>(constants_[operand]);
+            case node_kind::boolean_literal:
+                return operand < constants_.size() && std::holds_alternative<bool>(constants_[operand]);
+            case node_kind::string_literal:
+                return operand < constants_.size() && std::holds_alternative<std::string>(constants_[operand]);
+            case node_kind::char_literal:
+                return operand < constants_.size() && std::holds_alternative<char>(constants_[operand]);
+            default:
+                return false;
+        }
+    }
+
+    struct pair_hash {
+        std::size_t operator()(const std::pair<std::size_t, std::uint64_t> &key) const noexcept {
+            return std::hash<std::uint64_t>{}(key.second * 0x9e3779b97f4a7c15 + key.first);
+        }
+    };
+
+    // scalar constants by type and bits, while lowering
+    using constant_map = std::unordered_map<std::pair<std::size_t, std::uint64_t>, index_type, pair_hash>;
+
+    index_type constant(const value_t &value, constant_map &scalars) {
+        std::uint64_t bits = 0;
+        switch (static_cast<variable_type>(value.index())) {
+            case variable_type::integer:
+                bits = static_cast<std::uint32_t>(std::get<int32_t>(value));
+                break;
+            case variable_type::floating:
+                bits = std::bit_cast<std::uint64_t>(std::get<double>(value));
+                break;
+            case variable_type::boolean:
+                bits = std::get<bool>(value);
+                break;
+            case variable_type::character:
+                bits = static_cast<unsigned char>(std::get<char>(value));
+                break;
+            default:
+                constants_.push_back(value);
+                return static_cast<index_type>(constants_.size() - 1);
+        }
+        auto [iter, inserted] = scalars.try_emplace({value.index(), bits}, static_cast<index_type>(constants_.size()));
+        if (inserted) {
+            constants_.push_back(value);
+        }
+        return iter->second;
+    }
+
+    // the operand of `node` lowered `index`-th, null once there is none
+    static const expr_node *lowered_operand(const expr_node &node, std::size_t index) {
+        switch (node.kind()) {
+            case node_kind::add:
+            case node_kind::minus:
+            case node_kind::multiply:
+            case node_kind::divide:
+            case node_kind::modulus:
+            case node_kind::logical_and:
+            case node_kind::logical_or:
+            case node_kind::bit_and:
+            case node_kind::bit_or:
+            case node_kind::bit_xor:
+            case node_kind::shift_left:
+            case node_kind::shift_right:
+            case node_kind::less:
+            case node_kind::less_equal:
+            case node_kind::greater:
+            case node_kind::greater_equal:
+            case node_kind::equal:
+            case node_kind::not_equal: {
+                const auto &binary = static_cast<const binary_expr_node &>(node);
+                return index == 0 ? binary.lhs() : index == 1 ? binary.rhs() : nullptr;
+            }
+            case node_kind::array_value: {
+                const auto &value = static_cast<const array_value_node &>(node);
+                return index == 0 ? value.array_expr() : index == 1 ? value.index_expr() : nullptr;
+            }
+            case node_kind::negative:
+            case node_kind::logical_not:
+            case node_kind::bit_not:
+                return index == 0 ? static_cast<const unary_node &>(node).expr() : nullptr;
+            case node_kind::type_cast:
+                return index == 0 ? static_cast<const type_cast_node &>(node).expr() : nullptr;
+            case node_kind::array: {
+                const auto sizes = static_cast<const array_node &>(node).sizes();
+                return index < sizes.size() ? sizes[index] : nullptr;
+            }
+            case node_kind::int_literal:
+            case node_kind::float_literal:
+            case node_kind::boolean_literal:
+            case node_kind::string_literal:
+            case node_kind::char_literal:
+                return nullptr;
+            case node_kind::function_call:
+                throw_execute_error("function '{}' is called, a flat expression cannot call functions",
+                                    static_cast<const function_call_node &>(node).function()->name());
+            case node_kind::array_literal:
+                throw_execute_error("a flat expression cannot hold array literals");
+            case node_kind::interpolation:
+                throw_execute_error("a flat expression cannot hold interpolated strings");
+            default:
+                // statements are not expressions
+                std::unreachable();
+        }
+    }
+
+    // emits `node` once its operands are, at `operands`
+    index_type emit(const expr_node &node, std::span<const index_type> operands, constant_map &scalars) {
+        switch (node.kind()) {
+            case node_kind::negative:
+            case node_kind::logical_not:
+            case node_kind::bit_not:
+                return emit(node.kind(), 0);
+            case node_kind::type_cast:
+                return emit(node.kind(), static_cast<index_type>(static_cast<const type_cast_node &>(node).target_type()));
+            case node_kind::array: {
+                auto offset = static_cast<index_type>(list_storage_.size());
+                list_storage_.push_back(static_cast<index_type>(static_cast<const array_node &>(node).element_type()));
+                list_storage_.push_back(static_cast<index_type>(operands.size()));
+                list_storage_.insert(list_storage_.end(), operands.begin(), operands.end());
+                return emit(node.kind(), offset);
+            }
+            case node_kind::int_literal:
+            case node_kind::float_literal:
+            case node_kind::boolean_literal:
+            case node_kind::string_literal:
+            case node_kind::char_literal:
+                return emit(node.kind(), constant(node.value(), scalars));
+            default:
+                // binary nodes and indexes keep their first operand
+                return emit(node.kind(), operands.front());
+        }
+    }
+
+    // post-order without recursion, the stack holds the path from the root
+    // to the node being lowered, `lowered` the indexes of the operands
+    // emitted so far of each node on it
+    void lower(const expr_node &root, constant_map &scalars) {
+        struct frame {
+            const expr_node *node;
+            std::size_t next;
+        };
+        std::vector<frame> stack{{&root, 0}};
+        std::vector<index_type> lowered;
+        while (!stack.empty()) {
+            frame &top = stack.back();
+            if (const expr_node *operand = lowered_operand(*top.node, top.next)) {
+                top.next++;
+                stack.push_back({operand, 0});
+            } else {
+                const std::size_t first = lowered.size() - top.next;
+                const index_type index = emit(*top.node, std::span{lowered}.subspan(first), scalars);
+                lowered.resize(first);
+                lowered.push_back(index);
+                stack.pop_back();
+            }
+        }
+    }
+
+    // operand types were checked when the tree was built, other combinations
+    // fail like std::get on the wrong type does in the tree nodes
+    template <typename T>
+    constexpr static bool is_number = std::is_same_v<T, int32_t> || std::is_same_v<T, double>;
+
+    template <typename Op>
+    static value_t arithmetic(const value_t &lhs, const value_t &rhs) {
+        return std::visit([](const auto &l, const auto &r) -> value_t {
+            using L = std::remove_cvref_t<decltype(l)>;
+            using R = std::remove_cvref_t<decltype(r)>;
+            if constexpr (is_number<L> && is_number<R>) {
+                return Op{}(l, r);
+            } else if constexpr (std::is_same_v<Op, plus> && std::is_same_v<L, std::string> && std::is_same_v<R, std::string>) {
+                return Op{}(l, r);
+            } else {
+                throw std::bad_variant_access{};
+            }
+        }, lhs, rhs);
+    }
+
+    template <typename Op>
+    static value_t relation(const value_t &lhs, const value_t &rhs) {
+        return std::visit([](const auto &l, const auto &r) -> value_t {
+            using L = std::remove_cvref_t<decltype(l)>;
+            using R = std::remove_cvref_t<decltype(r)>;
+            if constexpr (is_number<L> && is_number<R>) {
+                return Op{}(l, r);
+            } else if constexpr (std::is_same_v<L, R> && !std::is_same_v<L, array>) {
+                return Op{}(l, r);
+            } else {
+                throw std::bad_variant_access{};
+            }
+        }, lhs, rhs);
+    }
+
+    // the operand of node `index` evaluated `next`-th, none once there is
+    // none, the right side of && and || is skipped when the left one, on top
+    // of `values`, decides the value
+    std::optional<index_type> next_operand(index_type index, index_type next, const std::vector<value_t> &values) const {
+        const index_type operand = operands_[index];
+        switch (kinds_[index]) {
+            case node_kind::add:
+            case node_kind::minus:
+            case node_kind::multiply:
+            case node_kind::divide:
+            case node_kind::modulus:
+            case node_kind::bit_and:
+            case node_kind::bit_or:
+            case node_kind::bit_xor:
+            case node_kind::shift_left:
+            case node_kind::shift_right:
+            case node_kind::less:
+            case node_kind::less_equal:
+            case node_kind::greater:
+            case node_kind::greater_equal:
+            case node_kind::equal:
+            case node_kind::not_equal:
+            case node_kind::array_value:
+                if (next == 0) {
+                    return operand;
+                }
+                return next == 1 ? std::optional{index - 1} : std::nullopt;
+            case node_kind::logical_and:
+            case node_kind::logical_or:
+                if (next == 0) {
+                    return operand;
+                }
+                if (next == 1 && std::get<bool>(values.back()) == (kinds_[index] == node_kind::logical_and)) {
+                    return index - 1;
+                }
+                return std::nullopt;
+            case node_kind::negative:
+            case node_kind::logical_not:
+            case node_kind::bit_not:
+            case node_kind::type_cast:
+                return next == 0 ? std::optional{index - 1} : std::nullopt;
+            case node_kind::array:
+                return next < lists_[operand + 1] ? std::optional{lists_[operand + 2 + next]} : std::nullopt;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // post-order without recursion like expr_node::evaluate(), `values`
+    // holds the values of the operands evaluated so far of each node on the
+    // stack
+    value_t evaluate(index_type root) const {
+        struct frame {
+            index_type index;
+            index_type next;
+        };
+        thread_local std::vector<frame> stack;
+        thread_local std::vector<value_t> values;
+        const std::size_t stack_base = stack.size();
+        const std::size_t values_base = values.size();
+        stack.push_back({root, 0});
+        try {
+            while (stack.size() > stack_base) {
+                frame &top = stack.back();
+                if (std::optional<index_type> operand = next_operand(top.index, top.next, values)) {
+                    top.next++;
+                    stack.push_back({*operand, 0});
+                } else {
+                    const std::size_t first = values.size() - top.next;
+                    value_t value = compute(top.index, std::span{values}.subspan(first));
+                    values.erase(values.begin() + static_cast<std::ptrdiff_t>(first), values.end());
+                    values.push_back(std::move(value));
+                    stack.pop_back();
+                }
+            }
+        } catch (...) {
+            stack.resize(stack_base);
+            values.erase(values.begin() + static_cast<std::ptrdiff_t>(values_base), values.end());
+            throw;
+        }
+        value_t value = std::move(values.back());
+        values.pop_back();
+        return value;
+    }
+
+    // the value of node `index` from those of its operands, in order
+    value_t compute(index_type index, std::span<value_t> operands) const {
+        const index_type operand = operands_[index];
+        switch (kinds_[index]) {
+            case node_kind::int_literal:
+            case node_kind::float_literal:
+            case node_kind::boolean_literal:
+            case node_kind::string_literal:
+            case node_kind::char_literal:
+                return constants_[operand];
+            case node_kind::add:
+                return arithmetic<plus>(operands[0], operands[1]);
+            case node_kind::minus:
+                return arithmetic<minus>(operands[0], operands[1]);
+            case node_kind::multiply:
+                return arithmetic<multiplies>(operands[0], operands[1]);
+            case node_kind::divide: {
+                const value_t &rhs = operands[1];
+                if ((std::holds_alternative<int32_t>(rhs) && std::get<int32_t>(rhs) == 0) ||
+                    (std::holds_alternative<double>(rhs) && std::get<double>(rhs) == 0)) {
+                    throw_execute_error("division by zero");
+                }
+                return arithmetic<divides>(operands[0], rhs);
+            }
+            case node_kind::modulus:
+                return modulus{}(std::get<int32_t>(operands[0]), std::get<int32_t>(operands[1]));
+            case node_kind::logical_and:
+            case node_kind::logical_or:
+                // the right side when it was evaluated, else the left one
+                return std::get<bool>(operands.back());
+            case node_kind::bit_and:
+                return bit_and{}(std::get<int32_t>(operands[0]), std::get<int32_t>(operands[1]));
+            case node_kind::bit_or:
+                return bit_or{}(std::get<int32_t>(operands[0]), std::get<int32_t>(operands[1]));
+            case node_kind::bit_xor:
+                return bit_xor{}(std::get<int32_t>(operands[0]), std::get<int32_t>(operands[1]));
+            case node_kind::shift_left:
+            case node_kind::shift_right:
+                return shift(kinds_[index] == node_kind::shift_left, operands[0], operands[1]);
+            case node_kind::less:
+                return relation<less>(operands[0], operands[1]);
+            case node_kind::less_equal:
+                return relation<less_equal>(operands[0], operands[1]);
+            case node_kind::greater:
+                return relation<greater>(operands[0], operands[1]);
+            case node_kind::greater_equal:
+                return relation<greater_equal>(operands[0], operands[1]);
+            case node_kind::equal:
+                return relation<equal>(operands[0], operands[1]);
+            case node_kind::not_equal:
+                return relation<not_equal>(operands[0], operands[1]);
+            case node_kind::negative:
+                if (std::holds_alternative<int32_t>(operands[0])) {
+                    return -std::get<int32_t>(operands[0]);
+                }
+                return -std::get<double>(operands[0]);
+            case node_kind::logical_not:
+                return !std::get<bool>(operands[0]);
+            case node_kind::bit_not:
+                return ~std::get<int32_t>(operands[0]);
+            case node_kind::type_cast:
+                return type_cast(std::move(operands[0]), static_cast<variable_type>(operand));
+            case node_kind::array_value: {
+                const array &arr = std::get<array>(operands[0]);
+                int32_t position = std::get<int32_t>(operands[1]);
+                if (position < 0 || static_cast<array::size_type>(position) >= arr.size()) {
+                    throw_execute_error("index {} out of bounds: array size is {}", position, arr.size());
+                }
+                return arr[position];
+            }
+            case node_kind::array:
+                return build_array(operand, operands);
+            default:
+                std::unreachable();
+        }
+    }
+
+    static value_t shift(bool left, const value_t &lhs_value, const value_t &rhs_value) {
+        int32_t lhs = std::get<int32_t>(lhs_value);
+        int32_t rhs = std::get<int32_t>(rhs_value);
+        if (rhs < 0) {
+            if (left) {
+                throw_type_error("right operand of shift expression is negative: {}", rhs);
+            }
+            throw_execute_error("right operand of shift expression is negative: {}", rhs);
+        }
+        rhs %= std::numeric_limits<uint32_t>::digits;
+        return left ? lhs << rhs : lhs >> rhs;
+    }
+
+    static value_t type_cast(value_t value, variable_type target) {
+        auto original = static_cast<variable_type>(value.index());
+        if (original == target) {
+            return value;
+        }
+        if (original == variable_type::integer && target == variable_type::floating) {
+            return static_cast<double>(std::get<int32_t>(value));
+        }
+        if (original == variable_type::floating && target == variable_type::integer) {
+            return static_cast<int32_t>(std::get<double>(value));
+        }
+        if (original == variable_type::character && target == variable_type::integer) {
+            return static_cast<int32_t>(std::get<char>(value));
+        }
+        throw_type_error("cannot cast {} to {}", original, target);
+    }
+
+    // the innermost array first, each outer one holds copies of the array
+    // inside it, which share its elements until one of them is changed
+    array build_array(index_type list, std::span<const value_t> sizes) const {
+        auto elem_type = static_cast<variable_type>(lists_[list]);
+        for (const value_t &size : sizes) {
+            if (std::get<int32_t>(size) <= 0) {
+                throw_execute_error("array size must be positive");
+            }
+        }
+        array arr{elem_type};
+        for (int32_t i = 0; i < std::get<int32_t>(sizes.back()); i++) {
+            switch (elem_type) {
+                case variable_type::integer:
+                    arr.push_back(int32_t{});
+                    break;
+                case variable_type::floating:
+                    arr.push_back(double{});
+                    break;
+                case variable_type::boolean:
+                    arr.push_back(bool{});
+                    break;
+                case variable_type::string:
+                    arr.push_back(std::string{});
+                    break;
+                case variable_type::character:
+                    arr.push_back(char{});
+                    break;
+                default:
+                    std::unreachable();
+            }
+        }
+        for (std::size_t dimension = sizes.size() - 1; dimension-- > 0; ) {
+            array outer{variable_type::array};
+            for (int32_t i = 0; i < std::get<int32_t>(sizes[dimension]); i++) {
+                outer.push_back(arr);
+            }
+            arr = std::move(outer);
+        }
+        return arr;
+    }
+};
+
+}   // namespace neroll::script::detail
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef NEROLL_SCRIPT_DETAIL_HASH_CONS_H
+#define NEROLL_SCRIPT_DETAIL_HASH_CONS_H
+
+#include <algorithm>        // equal
+#include <bit>              // bit_cast
+#include <cstddef>          // size_t
+#include <cstdint>          // uint64_t
+#include <functional>       // hash
+#include <span>             // span
+#include <string>           // string
+#include <string_view>      // string_view
+#include <unordered_map>    // unordered_map
+#include "ast.h"
+
+namespace neroll::script::detail {
+
+// what makes an expression node the same as another: its kind, the scalar
+// or text it holds and its operands, which are interned before it, so they
+// compare by address
+struct node_key {
+    node_kind kind{};
+    // the target of a cast, the elements of an array
+    variable_type type{};
+    // the bits of a number, boolean or character literal
+    std::uint64_t bits = 0;
+    std::string_view text;
+    const expr_node *lhs = nullptr;
+    const expr_node *rhs = nullptr;
+    // the sizes of an array, the elements of an array literal
+    std::span<expr_node *const> list;
+
+    // views what `node` holds, so the key lives as long as the node
+    explicit node_key(const expr_node &node) : kind(node.kind()) {
+        switch (kind) {
+            case node_kind::int_literal:
+                bits = static_cast<std::uint32_t>(node.get<int32_t>());
+                break;
+            case node_kind::float_literal:
+                bits = std::bit_cast<std::uint64_t>(node.get<double>());
+                break;
+            case node_kind::boolean_literal:
+                bits = node.get<bool>();
+                break;
+            case node_kind::char_literal:
+                bits = static_cast<unsigned char>(node.get<char>());
+                break;
+            case node_kind::string_literal:
+                text = node.get<std::string>();
+                break;
+            case node_kind::negative:
+            case node_kind::logical_not:
+            case node_kind::bit_not:
+                lhs = static_cast<const unary_node &>(node).expr();
+                break;
+            case node_kind::type_cast:
+                lhs = static_cast<const type_cast_node &>(node).expr();
+                type = static_cast<const type_cast_node &>(node).target_type();
+                break;
+            case node_kind::array_value:
+                lhs = static_cast<const array_value_node &>(node).array_expr();
+                rhs = static_cast<const array_value_node &>(node).index_expr();
+                break;
+            case node_kind::array:
+                type = static_cast<const array_node &>(node).element_type();
+                list = static_cast<const array_node &>(node).sizes();
+                break;
+            case node_kind::array_literal:
+                list = static_cast<const array_literal_node &>(node).elements();
+                break;
+            default:
+                lhs = static_cast<const binary_expr_node &>(node).lhs();
+                rhs = static_cast<const binary_expr_node &>(node).rhs();
+                break;
+        }
+    }
+
+    bool operator==(const node_key &other) const noexcept {
+        return kind == other.kind && type == other.type && bits == other.bits && text == other.text &&
+               lhs == other.lhs && rhs == other.rhs && std::ranges::equal(list, other.list);
+    }
+};
+
+struct node_key_hash {
+    std::size_t operator()(const node_key &key) const noexcept {
+        std::uint64_t hash = static_cast<std::uint64_t>(key.kind) << 8 | static_cast<std::uint64_t>(key.type);
+        auto mix = [&hash](std::uint64_t value) {
+            hash = (hash ^ value) * 0x9e3779b97f4a7c15;
+            hash ^= hash >> 29;
+        };
+        mix(key.bits);
+        mix(std::hash<std::string_view>{}(key.text));
+        mix(std::bit_cast<std::uintptr_t>(key.lhs));
+        mix(std::bit_cast<std::uintptr_t>(key.rhs));
+        for (const expr_node *operand : key.list) {
+            mix(std::bit_cast<std::uintptr_t>(operand));
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+// one node per structurally distinct expression, for expressions that
+// evaluate to the same value wherever they appear, calls are not interned
+//
+// a node found here gets several parents, each of them evaluates it again
+// and reads the same value
+class hash_cons_table {
+ public:
+    // the node made before that is the same as `node`, null if there is none
+    [[nodiscard]]
+    expr_node *find(const expr_node &node) const {
+        auto iter = nodes_.find(node_key{node});
+        return iter == nodes_.end() ? nullptr : iter->second;
+    }
+
+    // `node` stands for the nodes the same as it from now on
+    void insert(expr_node *node) {
+        nodes_.emplace(node_key{*node}, node);
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return nodes_.size();
+    }
+
+ private:
+    std::unordered_map<node_key, expr_node *, node_key_hash> nodes_;
+};
+
+}   // namespace neroll::script::detail
+
+#endif
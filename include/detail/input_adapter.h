@@ -1,7 +1,31 @@
 #ifndef NEROLL_SCRIPT_DETAIL_INPUT_ADAPTER_H
 #define NEROLL_SCRIPT_DETAIL_INPUT_ADAPTER_H
 
-#include <istream>  // istream
+#include <cerrno>         // errno
+#include <concepts>       // convertible_to
+#include <cstddef>        // size_t
+#include <filesystem>     // path
+#include <istream>        // istream
+#include <memory>         // unique_ptr
+#include <span>           // span
+#include <string>         // char_traits
+#include <string_view>    // string_view
+#include <system_error>   // system_error
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>      // CreateFileW, CreateFileMappingW, MapViewOfFile
+#else
+#include <fcntl.h>        // open
+#include <sys/mman.h>     // mmap, munmap, madvise
+#include <sys/stat.h>     // fstat
+#include <unistd.h>       // close
+#endif
 
 namespace neroll {
 
@@ -52,6 +76,241 @@ class input_stream_adapter {
     std::istream *is = nullptr;
     std::streambuf *sb = nullptr;
 };
+
+// reads the stream in blocks through sgetn, so only a refill goes through
+// the streambuf and the per-character path is a pointer increment
+class buffered_stream_adapter {
+ public:
+    using char_type = char;
+
+    constexpr static std::size_t block_size = 64 * 1024;
+
+    explicit buffered_stream_adapter(std::istream &i)
+        : is(&i), sb(i.rdbuf()), buffer(std::make_unique<char_type[]>(block_size)) {}
+
+    ~buffered_stream_adapter() {
+        if (is != nullptr) {
+            is->clear(is->rdstate() & std::ios::eofbit);
+        }
+    }
+
+    buffered_stream_adapter(const buffered_stream_adapter&) = delete;
+    buffered_stream_adapter& operator=(const buffered_stream_adapter&) = delete;
+    buffered_stream_adapter& operator=(buffered_stream_adapter&&) = delete;
+
+    buffered_stream_adapter(buffered_stream_adapter &&rhs) noexcept
+        : is(rhs.is), sb(rhs.sb), buffer(std::move(rhs.buffer)), cursor(rhs.cursor), end(rhs.end) {
+        rhs.is = nullptr;
+        rhs.sb = nullptr;
+        rhs.cursor = nullptr;
+        rhs.end = nullptr;
+    }
+
+    std::char_traits<char>::int_type get_character() {
+        if (cursor == end) [[unlikely]] {
+            if (!refill()) {
+                return std::char_traits<char>::eof();
+            }
+        }
+        return std::char_traits<char>::to_int_type(*cursor++);
+    }
+
+    void rewind() {
+        if (is != nullptr) {
+            is->clear();
+            is->seekg(0);
+            cursor = end = nullptr;
+        }
+    }
+
+ private:
+    std::istream *is = nullptr;
+    std::streambuf *sb = nullptr;
+    std::unique_ptr<char_type[]> buffer;
+    const char_type *cursor = nullptr;
+    const char_type *end = nullptr;
+
+    bool refill() {
+        auto count = sb->sgetn(buffer.get(), block_size);
+        if (count <= 0) {
+            is->clear(is->rdstate() | std::ios::eofbit);
+            return false;
+        }
+        cursor = buffer.get();
+        end = cursor + count;
+        return true;
+    }
+};
+
+// views memory owned by the caller, nothing is copied
+class span_input_adapter {
+ public:
+    using char_type = char;
+
+    explicit span_input_adapter(std::string_view source) noexcept
+        : data_(source.data()), size_(source.size()) {}
+
+    explicit span_input_adapter(std::span<const char_type> source) noexcept
+        : data_(source.data()), size_(source.size()) {}
+
+    [[nodiscard]]
+    const char_type *data() const noexcept {
+        return data_;
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+    std::char_traits<char>::int_type get_character() noexcept {
+        if (cursor_ == size_) [[unlikely]] {
+            return std::char_traits<char>::eof();
+        }
+        return std::char_traits<char>::to_int_type(data_[cursor_++]);
+    }
+
+    void rewind() noexcept {
+        cursor_ = 0;
+    }
+
+ private:
+    const char_type *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t cursor_ = 0;
+};
+
+// maps a whole file read-only, the lexer walks the mapping with a pointer
+// instead of pulling characters one by one
+class mmap_input_adapter {
+ public:
+    using char_type = char;
+
+    explicit mmap_input_adapter(const std::filesystem::path &file) {
+        map(file);
+    }
+
+    ~mmap_input_adapter() {
+        unmap();
+    }
+
+    mmap_input_adapter(const mmap_input_adapter&) = delete;
+    mmap_input_adapter& operator=(const mmap_input_adapter&) = delete;
+    mmap_input_adapter& operator=(mmap_input_adapter&&) = delete;
+
+    mmap_input_adapter(mmap_input_adapter &&rhs) noexcept
+        : data_(rhs.data_), size_(rhs.size_), cursor_(rhs.cursor_) {
+        rhs.data_ = nullptr;
+        rhs.size_ = 0;
+        rhs.cursor_ = 0;
+    }
+
+    [[nodiscard]]
+    const char_type *data() const noexcept {
+        return data_;
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+    std::char_traits<char>::int_type get_character() noexcept {
+        if (cursor_ == size_) [[unlikely]] {
+            return std::char_traits<char>::eof();
+        }
+        return std::char_traits<char>::to_int_type(data_[cursor_++]);
+    }
+
+    void rewind() noexcept {
+        cursor_ = 0;
+    }
+
+ private:
+    const char_type *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t cursor_ = 0;
+
+#ifdef _WIN32
+    void map(const std::filesystem::path &file) {
+        HANDLE handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                    "cannot open " + file.string());
+        }
+        LARGE_INTEGER file_size{};
+        if (!GetFileSizeEx(handle, &file_size)) {
+            auto error = static_cast<int>(GetLastError());
+            CloseHandle(handle);
+            throw std::system_error(error, std::system_category(), "cannot stat " + file.string());
+        }
+        size_ = static_cast<std::size_t>(file_size.QuadPart);
+        if (size_ == 0) {
+            CloseHandle(handle);
+            return;
+        }
+        HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(handle);
+        if (mapping == nullptr) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                    "cannot map " + file.string());
+        }
+        data_ = static_cast<const char_type *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        auto error = static_cast<int>(GetLastError());
+        CloseHandle(mapping);
+        if (data_ == nullptr) {
+            throw std::system_error(error, std::system_category(), "cannot map " + file.string());
+        }
+    }
+
+    void unmap() noexcept {
+        if (data_ != nullptr) {
+            UnmapViewOfFile(data_);
+        }
+    }
+#else
+    void map(const std::filesystem::path &file) {
+        int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            throw std::system_error(errno, std::generic_category(), "cannot open " + file.string());
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) == -1) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "cannot stat " + file.string());
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ == 0) {
+            ::close(fd);
+            return;
+        }
+        void *address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "cannot map " + file.string());
+        }
+        ::madvise(address, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char_type *>(address);
+    }
+
+    void unmap() noexcept {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char_type *>(data_), size_);
+        }
+    }
+#endif
+};
+
+// adapters exposing the whole input as one contiguous buffer, the lexer
+// slices tokens out of them instead of copying characters
+template <typename T>
+concept contiguous_input_adapter = requires(const T &adapter) {
+    { adapter.data() } -> std::convertible_to<const typename T::char_type *>;
+    { adapter.size() } -> std::convertible_to<std::size_t>;
+};
     
 }   // namespace detail
 
@@ -2,17 +2,26 @@
 #define NEROLL_SCRIPT_DETAIL_LEXER_H
 
 #include <print>
+#include <array>            // array
 #include <string>           // string
-#include <cstddef>          // size_t
+#include <cstddef>          // size_t, ptrdiff_t
+#include <charconv>         // from_chars
+#include <cstdint>          // uint8_t, int32_t
 #include <format>           // formatter
+#include <memory>           // shared_ptr
+#include <optional>         // optional
 #include <string_view>      // string_view
-#include <unordered_map>    // unordered_map
 #include <cassert>          // assert
+#include <system_error>     // errc
+#include <utility>          // pair, move
+#include <variant>          // variant, monostate
 
 #include "detail/position_t.h"
 #include "exception.h"      // throw_syntax_error
 #include "input_adapter.h"  // input_stream_adapter
-#include "position_t.h"     // position_t
+#include "position_t.h"     // position_t, line_index
+#include "scan.h"           // scan, has_class
+#include "symbol_table.h"   // symbol_table, string_pool
 
 namespace neroll {
 
@@ -20,7 +29,7 @@ namespace script {
 
 namespace detail {
 
-enum class token_type {
+enum class token_type : std::uint8_t {
     keyword_int,        // int
     keyword_float,      // double
     keyword_boolean,    // boolean
@@ -47,6 +56,7 @@ enum class token_type {
     literal_false,      // false
     literal_string,     // "string"
     literal_char,       // 'c'
+    literal_interpolated,   // $"text {expression}"
 
     identifier,
 
@@ -97,20 +107,71 @@ enum class token_type {
     parse_error
 };
 
+static_assert(reserved_words.size() == static_cast<std::size_t>(token_type::keyword_new) + 1);
+static_assert(reserved_words[static_cast<std::size_t>(token_type::keyword_float)] == "float");
+static_assert(reserved_words[static_cast<std::size_t>(token_type::keyword_new)] == "new");
+
+// decoded value of literal_int and literal_float tokens
+using number_t = std::variant<std::monostate, std::int32_t, double>;
+
+// `text` has been matched by the number grammar, only the range can fail
+template <typename T>
+bool decode_number(std::string_view text, T &value) noexcept {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{};
+}
+
+// what the character after a backslash stands for in a literal, none if
+// the pair is not an escape
+constexpr std::optional<char> escape_value(int c) noexcept {
+    switch (c) {
+        case 't':
+            return '\t';
+        case 'f':
+            return '\f';
+        case 'r':
+            return '\r';
+        case 'n':
+            return '\n';
+        case 'b':
+            return '\b';
+        case '\\':
+            return '\\';
+        case '"':
+            return '"';
+        case '\'':
+            return '\'';
+        default:
+            return std::nullopt;
+    }
+}
+
 struct token {
-    std::string content;
+    // views the source buffer, a static spelling, or storage owned by the
+    // lexer or its symbol table, and stays valid while the lexer lives
+    std::string_view content;
     token_type type{};
-    std::size_t line{};
-    std::size_t column{};
+    symbol_id symbol = no_symbol;   // identifiers and keywords only
+    number_t number;                // literal_int and literal_float only
+    // characters read when the token was returned, one past its last
+    // character, the line and column come from the lexer's line_index
+    std::size_t offset{};
+    // characters read before its first character
+    std::size_t start{};
 
     token() = default;
 
-    token(token_type type_, const position_t &position)
-        : token("", type_, position) {}
+    token(token_type type_, std::size_t offset_)
+        : token("", type_, offset_) {}
     
-    token(std::string_view content_, token_type type_, const position_t &position)
-        : content(content_), type(type_), line(position.lines_read + 1),
-          column(position.chars_read_current_line) {}
+    token(std::string_view content_, token_type type_, std::size_t offset_)
+        : content(content_), type(type_), offset(offset_) {}
+
+    token(std::string_view content_, token_type type_, symbol_id symbol_, std::size_t offset_)
+        : content(content_), type(type_), symbol(symbol_), offset(offset_) {}
+
+    token(std::string_view content_, token_type type_, number_t number_, std::size_t offset_)
+        : content(content_), type(type_), number(number_), offset(offset_) {}
 };
 
 const char *token_type_name(token_type type) {
@@ -155,6 +216,8 @@ const char *token_type_name(token_type type) {
             return "literal string";
         case token_type::literal_char:
             return "literal char";
+        case token_type::literal_interpolated:
+            return "interpolated string";
         case token_type::identifier:
             return "identifier";
         case token_type::plus:
@@ -234,109 +297,302 @@ const char *token_type_name(token_type type) {
     }
 }
 
+struct keyword_entry {
+    std::string_view spelling;
+    token_type type{};
+};
+
+constexpr std::array<keyword_entry, 16> keyword_list{{
+    {"int", token_type::keyword_int}, {"float", token_type::keyword_float},
+    {"boolean", token_type::keyword_boolean}, {"string", token_type::keyword_string},
+    {"char", token_type::keyword_char}, {"function", token_type::keyword_function},
+    {"if", token_type::keyword_if}, {"else", token_type::keyword_else},
+    {"for", token_type::keyword_for}, {"while", token_type::keyword_while},
+    {"continue", token_type::keyword_continue}, {"break", token_type::keyword_break},
+    {"return", token_type::keyword_return}, {"new", token_type::keyword_new},
+    {"true", token_type::literal_true}, {"false", token_type::literal_false}
+}};
+
+constexpr std::size_t keyword_min_length = 2;
+constexpr std::size_t keyword_max_length = 8;
+
+// collision free for keyword_list, checked when keyword_table is built
+constexpr std::size_t keyword_hash(std::string_view word) noexcept {
+    return (static_cast<unsigned char>(word[0]) * 2u + static_cast<unsigned char>(word[1]) * 20u + word.size()) & 31u;
+}
+
+constexpr std::array<keyword_entry, 32> keyword_table = [] {
+    std::array<keyword_entry, 32> table{};
+    for (const keyword_entry &keyword : keyword_list) {
+        keyword_entry &slot = table[keyword_hash(keyword.spelling)];
+        if (!slot.spelling.empty()) {
+            throw "keyword_hash collides, pick other multipliers";
+        }
+        slot = keyword;
+    }
+    return table;
+}();
+
+// keywords and boolean literals, one probe into a table built at compile time
+constexpr const keyword_entry *find_keyword(std::string_view word) noexcept {
+    if (word.size() < keyword_min_length || word.size() > keyword_max_length) {
+        return nullptr;
+    }
+    const keyword_entry &entry = keyword_table[keyword_hash(word)];
+    return entry.spelling == word ? &entry : nullptr;
+}
+
+static_assert(find_keyword("continue")->type == token_type::keyword_continue);
+static_assert(find_keyword("false")->type == token_type::literal_false);
+static_assert(find_keyword("whilst") == nullptr);
+
+template <typename InputAdapter>
 class lexer {
  public:
-    using char_type     = typename input_stream_adapter::char_type;
+    using char_type     = typename InputAdapter::char_type;
     using char_int_type = typename std::char_traits<char_type>::int_type;
 
-    explicit lexer(input_stream_adapter &&adapter)
-        : adapter_(std::move(adapter)) {}
+    explicit lexer(InputAdapter &&adapter,
+                   std::shared_ptr<symbol_table> symbols = std::make_shared<symbol_table>())
+        : adapter_(std::move(adapter)), symbols_(std::move(symbols)) {
+        if constexpr (contiguous) {
+            begin_ = adapter_.data();
+            cursor_ = begin_;
+            end_ = begin_ + adapter_.size();
+        }
+    }
 
     token next_token() {
         skip_whitespace();
+        // current_ has been read
+        const std::size_t start = offset_ - 1;
+        token tok = lex_token();
+        tok.start = start;
+        return tok;
+    }
+
+    void rewind() {
+        if constexpr (contiguous) {
+            cursor_ = begin_;
+        } else {
+            adapter_.rewind();
+        }
+    }
+    
+    // characters read so far
+    [[nodiscard]]
+    std::size_t offset() const noexcept {
+        return offset_;
+    }
+
+    [[nodiscard]]
+    position_t position() const {
+        return position_at(offset_);
+    }
+
+    // line and column of an offset already read, e.g. token::offset
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const {
+        if constexpr (contiguous) {
+            lines_.index(source(), base_, offset);
+        }
+        return lines_.position_at(offset);
+    }
+
+    // continue counting from `offset` with the lines seen so far, for input
+    // lexed in parts, the input starts at `offset`
+    void resume(std::size_t offset, line_index lines) noexcept {
+        offset_ = offset;
+        base_ = offset;
+        lines_ = std::move(lines);
+    }
+
+    // hands the line index back after resume(), indexed up to what has
+    // been read
+    [[nodiscard]]
+    line_index release_lines() {
+        if constexpr (contiguous) {
+            lines_.index(source(), base_, offset_);
+        }
+        return std::move(lines_);
+    }
+
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return symbols_;
+    }
+
+    // source text of the token returned last, as an offset and a length
+    [[nodiscard]]
+    std::pair<std::size_t, std::size_t> token_range() const noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        return {static_cast<std::size_t>(token_begin_ - begin_),
+                static_cast<std::size_t>(cursor_ - token_begin_)};
+    }
+
+    [[nodiscard]]
+    std::string_view source() const noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        return {begin_, static_cast<std::size_t>(end_ - begin_)};
+    }
+
+    // the source from offset `from` up to offset `to`
+    [[nodiscard]]
+    std::string_view slice(std::size_t from, std::size_t to) const noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        return source().substr(from - base_, to - from);
+    }
+
+    // offset just past the '}' closing the block whose '{' is at offset
+    // `open`, found by brace matching without lexing, or npos
+    [[nodiscard]]
+    std::size_t block_end(std::size_t open) const noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        const char_type *stop = scan::block_end(begin_ + (open - base_), end_);
+        return stop == nullptr ? std::string_view::npos : base_ + static_cast<std::size_t>(stop - begin_);
+    }
+
+    // lexes on from `offset`, past what was read and between two tokens
+    void seek(std::size_t offset) noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        skip_to(begin_ + (offset - base_));
+    }
+
+ private:
+    constexpr static bool contiguous = contiguous_input_adapter<InputAdapter>;
+
+    InputAdapter adapter_;
+    std::shared_ptr<symbol_table> symbols_;
+    // decoded literals, and token text of stream adapters
+    string_pool literals_;
+    std::size_t offset_ = 0;
+    // offset of the first character of the input
+    std::size_t base_ = 0;
+    // filled while reading stream input and on demand for contiguous input
+    mutable line_index lines_;
+    bool next_unget_ = false;
+    char_int_type current_ = std::char_traits<char_type>::eof();
+    // only used by stream adapters, contiguous ones slice [token_begin_, cursor_)
+    std::string token_string_;
+    const char_type *begin_ = nullptr;
+    const char_type *cursor_ = nullptr;
+    const char_type *end_ = nullptr;
+    const char_type *token_begin_ = nullptr;
+
+    // the token at current_, the first character not skipped
+    token lex_token() {
+        if constexpr (contiguous) {
+            token_begin_ = current_ == std::char_traits<char_type>::eof() ? cursor_ : cursor_ - 1;
+        }
 
         switch (current_) {
             case '+':
-                return token{"+", token_type::plus, position_};
+                return token{"+", token_type::plus, offset_};
             case '-':
-                return token{"-", token_type::minus, position_};
+                return token{"-", token_type::minus, offset_};
             case '*':
-                return token{"*", token_type::asterisk, position_};
+                return token{"*", token_type::asterisk, offset_};
             case '/':
-                return token{"/", token_type::slash, position_};
+                return token{"/", token_type::slash, offset_};
             case '%':
-                return token{"%", token_type::mod, position_};
+                return token{"%", token_type::mod, offset_};
             case '&':
                 if (get() == '&')
-                    return token{"&&", token_type::logical_and, position_};
+                    return token{"&&", token_type::logical_and, offset_};
                 unget();
-                return token{"&", token_type::bit_and, position_};
+                return token{"&", token_type::bit_and, offset_};
             case '|':
                 if (get() == '|')
-                    return token{"||", token_type::logical_or, position_};
+                    return token{"||", token_type::logical_or, offset_};
                 unget();
-                return token{"|", token_type::bit_or, position_};
+                return token{"|", token_type::bit_or, offset_};
             case '^':
-                return token{"^", token_type::bit_xor, position_};
+                return token{"^", token_type::bit_xor, offset_};
             case '~':
-                return token{"~", token_type::bit_not, position_};
+                return token{"~", token_type::bit_not, offset_};
             case '<': {
                 char_int_type next = get();
                 if (next == '<')
-                    return token{"<<", token_type::shift_left, position_};
+                    return token{"<<", token_type::shift_left, offset_};
                 if (next == '=')
-                    return token{"<=", token_type::less_equal, position_};
+                    return token{"<=", token_type::less_equal, offset_};
                 unget();
-                return token{"<", token_type::less, position_};
+                return token{"<", token_type::less, offset_};
             }
             case '>': {
                 char_int_type next = get();
                 if (next == '>')
-                    return token{">>", token_type::shift_right, position_};
+                    return token{">>", token_type::shift_right, offset_};
                 if (next == '=')
-                    return token{">=", token_type::greater_equal, position_};
+                    return token{">=", token_type::greater_equal, offset_};
                 unget();
-                return token{">", token_type::greater, position_};
+                return token{">", token_type::greater, offset_};
             }
             case '\\':
-                return token{"\\", token_type::backslash, position_};
+                return token{"\\", token_type::backslash, offset_};
             case '!':
                 if (get() == '=')
-                    return token{"!=", token_type::not_equal, position_};
+                    return token{"!=", token_type::not_equal, offset_};
                 unget();
-                return token{"!", token_type::logical_not, position_};
+                return token{"!", token_type::logical_not, offset_};
             case '=':
                 if (get() == '=')
-                    return token{"==", token_type::equal, position_};
+                    return token{"==", token_type::equal, offset_};
                 unget();
-                return token{"=", token_type::assign, position_};
+                return token{"=", token_type::assign, offset_};
             case ';':
-                return token{";", token_type::semicolon, position_};
+                return token{";", token_type::semicolon, offset_};
             case ':':
-                return token{":", token_type::colon, position_};
+                return token{":", token_type::colon, offset_};
             case ',':
-                return token{",", token_type::comma, position_};
+                return token{",", token_type::comma, offset_};
             case '.':
-                return token{".", token_type::dot, position_};
+                return token{".", token_type::dot, offset_};
             case '(':
-                return token{"(", token_type::left_parenthesis, position_};
+                return token{"(", token_type::left_parenthesis, offset_};
             case ')':
-                return token{")", token_type::right_parenthesis, position_};
+                return token{")", token_type::right_parenthesis, offset_};
             case '[':
-                return token{"[", token_type::left_bracket, position_};
+                return token{"[", token_type::left_bracket, offset_};
             case ']':
-                return token{"]", token_type::right_bracket, position_};
+                return token{"]", token_type::right_bracket, offset_};
             case '{':
-                return token{"{", token_type::left_brace, position_};
+                return token{"{", token_type::left_brace, offset_};
             case '}':
-                return token{"}", token_type::right_brace, position_};
+                return token{"}", token_type::right_brace, offset_};
             case '\'': {
                 char_int_type next = get();
                 if (next == '\'') {
                     throw_syntax_error("line {}, column {}: empty char literal",
-                        position_.lines_read + 1, position_.chars_read_current_line
+                        position().lines_read + 1, position().chars_read_current_line
                     );
                 }
                 char_int_type end = get();
                 if (end != '\'') {
                     throw_syntax_error("line {}, column {}: multiple character literal",
-                        position_.lines_read + 1, position_.chars_read_current_line
+                        position().lines_read + 1, position().chars_read_current_line
                     );
                 }
-                return token{std::string(1, static_cast<char_type>(next)), token_type::literal_char, position_};
+                return token{single_character(next), token_type::literal_char, offset_};
             }
             case '"':
                 return scan_string();
+            case '$': {
+                // the text is checked like a string but not decoded, the
+                // parser splits it at the braces
+                const char_type *begin = token_begin_;
+                get();
+                if (current_ != '"') {
+                    throw_syntax_error("line {}, column {}: unknown token",
+                        position().lines_read + 1, position().chars_read_current_line
+                    );
+                }
+                token tok = scan_interpolated();
+                if constexpr (contiguous) {
+                    token_begin_ = begin;
+                }
+                return tok;
+            }
             case '0':
             case '1':
             case '2':
@@ -350,100 +606,173 @@ class lexer {
                 return scan_number();
             case '\0':
             case std::char_traits<char_type>::eof():
-                return token{"eof", token_type::end_of_input, position_};
+                return token{"eof", token_type::end_of_input, offset_};
             default:
-                if (std::isalpha(current_) || current_ == '_') {
+                if (has_class(current_, char_class::alpha | char_class::underscore | char_class::non_ascii)) {
                     return scan_identifier();
                 }
                 throw_syntax_error("line {}, column {}: unknown token",
-                    position_.lines_read + 1, position_.chars_read_current_line
+                    position().lines_read + 1, position().chars_read_current_line
                 );
         }
     }
 
-    void rewind() {
-        adapter_.rewind();
-    }
-    
-    [[nodiscard]]
-    const position_t &position() const noexcept {
-        return position_;
+    // the content of a string token is its decoded text without the quotes,
+    // decoded in the same pass that finds the closing quote
+    token scan_string() {
+        reset();
+        if constexpr (contiguous) {
+            const char_type *run = cursor_;
+            skip_to(scan::string_special(cursor_, end_));
+            get();
+            // no escapes, view the source
+            if (current_ == '"') [[likely]] {
+                return {std::string_view{run, static_cast<std::size_t>(cursor_ - 1 - run)}, token_type::literal_string, offset_};
+            }
+            // otherwise build the text in the pool, a run at a time
+            while (current_ != '"') {
+                if (current_ != '\\') {
+                    throw_string_error();
+                }
+                literals_.append(std::string_view{run, static_cast<std::size_t>(cursor_ - 1 - run)});
+                literals_.append(escaped_character());
+                run = cursor_;
+                skip_to(scan::string_special(cursor_, end_));
+                get();
+            }
+            literals_.append(std::string_view{run, static_cast<std::size_t>(cursor_ - 1 - run)});
+            return {literals_.commit(), token_type::literal_string, offset_};
+        } else {
+            while (true) {
+                get();
+                if (current_ == '"') {
+                    break;
+                }
+                if (current_ == '\\') {
+                    const char_type c = escaped_character();
+                    // both characters of the escape were read into token_string_
+                    token_string_.resize(token_string_.size() - 2);
+                    token_string_.push_back(c);
+                } else if (has_class(current_, char_class::non_ascii)) {
+                    read_utf8_sequence("string literal");
+                } else if (current_ == '\n' || current_ == std::char_traits<char_type>::eof()) {
+                    throw_string_error();
+                }
+            }
+            const std::string_view text{token_string_};
+            return {literals_.store(text.substr(1, text.size() - 2)), token_type::literal_string, offset_};
+        }
     }
 
- private:
-    input_stream_adapter adapter_;
-    position_t position_;
-    bool next_unget_ = false;
-    char_int_type current_ = std::char_traits<char_type>::eof();
-    std::string token_string_;
-    const static inline std::unordered_map<std::string_view, token_type> keywords_ = {
-        {"int", token_type::keyword_int}, {"float", token_type::keyword_float},
-        {"boolean", token_type::keyword_boolean}, {"string", token_type::keyword_string},
-        {"char", token_type::keyword_char}, {"function", token_type::keyword_function},
-        {"if", token_type::keyword_if}, {"else", token_type::keyword_else},
-        {"for", token_type::keyword_for}, {"while", token_type::keyword_while},
-        {"continue", token_type::keyword_continue}, {"break", token_type::keyword_break},
-        {"return", token_type::keyword_return}, {"new", token_type::keyword_new}
-    };
-
-    token scan_string() {
+    // the content of an interpolated string is its text as written, with
+    // the escapes checked, what follows `$"` up to the closing quote
+    token scan_interpolated() {
         reset();
-        while (current_ != std::char_traits<char_type>::eof()) {
+        if constexpr (contiguous) {
+            const char_type *first = cursor_;
+            skip_to(scan::string_special(cursor_, end_));
             get();
-            if (current_ == '\n') {
-                throw_syntax_error("line {}, column {}: invalid string literal",
-                    position_.lines_read + 1, position_.chars_read_current_line
-                );
+            while (current_ != '"') {
+                if (current_ != '\\') {
+                    throw_string_error();
+                }
+                escaped_character();
+                skip_to(scan::string_special(cursor_, end_));
+                get();
             }
-            if (current_ == '"' && *(token_string_.rbegin() + 1) != '\\') {
-                break;
+            return {std::string_view{first, static_cast<std::size_t>(cursor_ - 1 - first)},
+                    token_type::literal_interpolated, offset_};
+        } else {
+            while (true) {
+                get();
+                if (current_ == '"') {
+                    break;
+                }
+                if (current_ == '\\') {
+                    escaped_character();
+                } else if (has_class(current_, char_class::non_ascii)) {
+                    read_utf8_sequence("string literal");
+                } else if (current_ == '\n' || current_ == std::char_traits<char_type>::eof()) {
+                    throw_string_error();
+                }
             }
+            const std::string_view text{token_string_};
+            return {literals_.store(text.substr(1, text.size() - 2)), token_type::literal_interpolated, offset_};
         }
-        if (current_ == std::char_traits<char_type>::eof()) {
-            throw_syntax_error("line {}, column {}: expect a double quotation",
-                position_.lines_read + 1, position_.chars_read_current_line
-            );
+    }
+
+    // reads the character after a backslash, returns what the escape stands for
+    char_type escaped_character() {
+        get();
+        if (const std::optional<char> value = escape_value(current_)) {
+            return *value;
         }
-        std::string escaped_string;
-        for (std::size_t i = 0; i < token_string_.size(); i++) {
-            if (token_string_[i] == '\\') {
-                char_int_type next = token_string_[i + 1];
-                switch (next) {
-                    case 't':
-                        escaped_string.push_back('\t');
-                        break;
-                    case 'f':
-                        escaped_string.push_back('\f');
-                        break;
-                    case 'r':
-                        escaped_string.push_back('\r');
-                        break;
-                    case 'n':
-                        escaped_string.push_back('\n');
-                        break;
-                    case 'b':
-                        escaped_string.push_back('\b');
-                        break;
-                    case '\\':
-                        escaped_string.push_back('\\');
-                        break;
-                    case '"':
-                        escaped_string.push_back('"');
-                        break;
-                    case '\'':
-                        escaped_string.push_back('\'');
-                        break;
-                    default:
-                        throw_syntax_error("line {}, column {}: invalid escape character \\{}",
-                            position_.lines_read + 1, position_.chars_read_current_line, static_cast<char_type>(current_)
-                        );
-                }
-                i++;
-            } else {
-                escaped_string.push_back(token_string_[i]);
+        if (current_ == '\n' || current_ == std::char_traits<char_type>::eof()) {
+            throw_string_error();
+        }
+        literals_.commit();
+        throw_syntax_error("line {}, column {}: invalid escape character \\{}",
+            position().lines_read + 1, position().chars_read_current_line, static_cast<char_type>(current_)
+        );
+    }
+
+    // reads the rest of the UTF-8 sequence led by current_, contiguous input
+    // is checked by the scan kernels instead
+    void read_utf8_sequence(std::string_view where) {
+        const position_t lead = position();
+        const std::ptrdiff_t length = scan::utf8_length(static_cast<unsigned char>(current_));
+        std::array<char_type, 4> sequence{std::char_traits<char_type>::to_char_type(current_)};
+        std::ptrdiff_t read = 1;
+        while (read < length && has_class(get(), char_class::non_ascii)) {
+            sequence[read++] = std::char_traits<char_type>::to_char_type(current_);
+        }
+        if (length == 0 || read < length
+            || scan::utf8_sequence_end(sequence.data(), sequence.data() + length) == nullptr) {
+            throw_utf8_error(lead, where);
+        }
+    }
+
+    // at the byte that starts the malformed sequence
+    [[noreturn]]
+    void throw_utf8_error(const position_t &position, std::string_view where) {
+        // drop a partly decoded literal
+        literals_.commit();
+        throw_syntax_error("line {}, column {}: invalid UTF-8 in {}",
+            position.lines_read + 1, position.chars_read_current_line, where
+        );
+    }
+
+    // current_ leads a malformed sequence found by a scan kernel, one cut
+    // off by the end of the input is read to the end, so the push lexer
+    // waits for the rest of it
+    [[noreturn]]
+    void throw_utf8_error_at_cursor(std::string_view where)
+        requires contiguous_input_adapter<InputAdapter> {
+        const position_t lead = position();
+        if (end_ - (cursor_ - 1) < scan::utf8_length(static_cast<unsigned char>(current_))) {
+            skip_to(end_);
+        }
+        throw_utf8_error(lead, where);
+    }
+
+    // a string literal ended by '\n', eof or a byte that is not UTF-8
+    [[noreturn]]
+    void throw_string_error() {
+        if constexpr (contiguous) {
+            if (has_class(current_, char_class::non_ascii)) {
+                throw_utf8_error_at_cursor("string literal");
             }
         }
-        return {std::move(escaped_string), token_type::literal_string, position_};
+        // drop a partly decoded literal
+        literals_.commit();
+        if (current_ == '\n') {
+            throw_syntax_error("line {}, column {}: invalid string literal",
+                position().lines_read + 1, position().chars_read_current_line
+            );
+        }
+        throw_syntax_error("line {}, column {}: expect a double quotation",
+            position().lines_read + 1, position().chars_read_current_line
+        );
     }
 
     token scan_number() {
@@ -671,79 +1000,168 @@ class lexer {
                     throw std::runtime_error("invalid state");
             }
         }
-        // check invalid number such as 123a
-        if (std::isalpha(current_)) {
-            return token{token_string_, token_type::parse_error, position_};
+        // check invalid number such as 123a, or 123é with all of the é
+        if (has_class(current_, char_class::alpha | char_class::non_ascii)) {
+            if (has_class(current_, char_class::non_ascii)) {
+                if constexpr (contiguous) {
+                    const char_type *next = scan::utf8_sequence_end(cursor_ - 1, end_);
+                    if (next == nullptr) {
+                        throw_utf8_error_at_cursor("number literal");
+                    }
+                    skip_to(next);
+                } else {
+                    read_utf8_sequence("number literal");
+                }
+            }
+            return token{stable_token_view(), token_type::parse_error, offset_};
         }
         unget();
         if (previous_state == 2 || previous_state == 3) {
-            return {token_string_, token_type::literal_int, position_};
+            std::int32_t value{};
+            if (!decode_number(token_view(), value)) {
+                throw_syntax_error("line {}, column {}: integer literal {} is out of range",
+                    position().lines_read + 1, position().chars_read_current_line, token_view()
+                );
+            }
+            return {stable_token_view(), token_type::literal_int, number_t{value}, offset_};
         }
         if (previous_state == 5 || previous_state == 8) {
-            return {token_string_, token_type::literal_float, position_};
+            double value{};
+            if (!decode_number(token_view(), value)) {
+                throw_syntax_error("line {}, column {}: floating literal {} is out of range",
+                    position().lines_read + 1, position().chars_read_current_line, token_view()
+                );
+            }
+            return {stable_token_view(), token_type::literal_float, number_t{value}, offset_};
         }
-        return {"invalid number literal", token_type::parse_error, position_};
+        return {"invalid number literal", token_type::parse_error, offset_};
     }
 
     token scan_identifier() {
         reset();
-        while (std::isalnum(current_) || current_ == '_') {
+        if constexpr (contiguous) {
+            // from the first character, it may lead a UTF-8 sequence
+            const char_type *stop = scan::identifier_end(token_begin_, end_);
+            if (stop == token_begin_) {
+                throw_utf8_error_at_cursor("identifier");
+            }
+            skip_to(stop);
+            // read and put back the terminator like the loop below, so
+            // offset_ ends up the same
             get();
+            if (has_class(current_, char_class::non_ascii)) {
+                throw_utf8_error_at_cursor("identifier");
+            }
+        } else {
+            while (has_class(current_, char_class::identifier | char_class::non_ascii)) {
+                if (has_class(current_, char_class::non_ascii)) {
+                    read_utf8_sequence("identifier");
+                }
+                get();
+            }
         }
         unget();
-        auto iter = keywords_.find(token_string_);
-        if (iter != keywords_.end())
-            return {iter->first, iter->second, position_};
-        if (token_string_ == "true")
-            return token{token_string_, token_type::literal_true, position_};
-        if (token_string_ == "false")
-            return token{token_string_, token_type::literal_false, position_};
-        return token{token_string_, token_type::identifier, position_};
+        const std::string_view identifier = token_view();
+        if (const keyword_entry *keyword = find_keyword(identifier)) {
+            if (keyword->type == token_type::literal_true || keyword->type == token_type::literal_false)
+                return token{keyword->spelling, keyword->type, offset_};
+            return {keyword->spelling, keyword->type, static_cast<symbol_id>(keyword->type), offset_};
+        }
+        symbol_id id = symbols_->intern(identifier);
+        if constexpr (contiguous) {
+            return token{identifier, token_type::identifier, id, offset_};
+        } else {
+            return token{symbols_->name(id), token_type::identifier, id, offset_};
+        }
     }
 
     char_int_type get() {
-        ++position_.chars_read_total;
-        ++position_.chars_read_current_line;
+        ++offset_;
 
-        if (next_unget_) {
-            next_unget_ = false;
+        if constexpr (contiguous) {
+            if (cursor_ != end_) [[likely]] {
+                current_ = std::char_traits<char_type>::to_int_type(*cursor_++);
+            } else {
+                current_ = std::char_traits<char_type>::eof();
+            }
         } else {
-            current_ = adapter_.get_character();
-        }
-
-        if (current_ != std::char_traits<char_type>::eof()) [[likely]] {
-            token_string_.push_back(std::char_traits<char_type>::to_char_type(current_));
-        }
+            if (next_unget_) {
+                next_unget_ = false;
+            } else {
+                current_ = adapter_.get_character();
+            }
 
-        if (current_ == '\n') {
-            ++position_.lines_read;
-            position_.chars_read_current_line = 0;
+            if (current_ != std::char_traits<char_type>::eof()) [[likely]] {
+                token_string_.push_back(std::char_traits<char_type>::to_char_type(current_));
+            }
+            // the text is gone once read, contiguous input is indexed when
+            // a position is asked for
+            if (current_ == '\n') {
+                lines_.add_line(offset_);
+            }
         }
 
         return current_;
     }
 
     void unget() {
-        next_unget_ = true;
-
-        position_.chars_read_total--;
-        if (position_.chars_read_current_line == 0) {
-            if (position_.lines_read > 0) {
-                position_.lines_read--;
+        if constexpr (contiguous) {
+            if (current_ != std::char_traits<char_type>::eof()) [[likely]] {
+                --cursor_;
             }
         } else {
-            position_.chars_read_current_line--;
+            next_unget_ = true;
         }
 
-        if (current_ != std::char_traits<char_type>::eof()) [[likely]] {
-            assert(!token_string_.empty());
-            token_string_.pop_back();
+        offset_--;
+
+        if constexpr (!contiguous) {
+            if (current_ != std::char_traits<char_type>::eof()) [[likely]] {
+                assert(!token_string_.empty());
+                token_string_.pop_back();
+            }
         }
     }
 
     void reset() {
-        token_string_.clear();
-        token_string_.push_back(std::char_traits<char_type>::to_char_type(current_));
+        if constexpr (contiguous) {
+            token_begin_ = cursor_ - 1;
+        } else {
+            token_string_.clear();
+            token_string_.push_back(std::char_traits<char_type>::to_char_type(current_));
+        }
+    }
+
+    // text of the token being scanned, from the character passed to reset()
+    // up to the last character read
+    [[nodiscard]]
+    std::string_view token_view() const noexcept {
+        if constexpr (contiguous) {
+            return {token_begin_, static_cast<std::size_t>(cursor_ - token_begin_)};
+        } else {
+            return token_string_;
+        }
+    }
+
+    // token_view() outlives the next token only for contiguous adapters
+    [[nodiscard]]
+    std::string_view stable_token_view() {
+        if constexpr (contiguous) {
+            return token_view();
+        } else {
+            return literals_.store(token_string_);
+        }
+    }
+
+    static std::string_view single_character(char_int_type c) noexcept {
+        constexpr static auto characters = [] {
+            std::array<char_type, 256> result{};
+            for (std::size_t i = 0; i < result.size(); i++) {
+                result[i] = static_cast<char_type>(i);
+            }
+            return result;
+        }();
+        return {&characters[static_cast<unsigned char>(c)], 1};
     }
 
     void add(char_int_type c) {
@@ -751,9 +1169,22 @@ class lexer {
     }
 
     void skip_whitespace() {
-        do {
+        if constexpr (contiguous) {
+            skip_to(scan::skip_whitespace(cursor_, end_));
             get();
-        } while (current_ == ' ' || current_ == '\n' || current_ == '\r' || current_ == '\t');
+        } else {
+            do {
+                get();
+            } while (has_class(current_, char_class::whitespace));
+        }
+    }
+
+    // moves the cursor to `stop`, counting characters as calling get() for
+    // every character before it would
+    void skip_to(const char_type *stop) noexcept
+        requires contiguous_input_adapter<InputAdapter> {
+        offset_ += static_cast<std::size_t>(stop - cursor_);
+        cursor_ = stop;
     }
 
 
@@ -0,0 +1,52 @@
+#ifndef NEROLL_SCRIPT_DETAIL_OUTPUT_FILE_H
+#define NEROLL_SCRIPT_DETAIL_OUTPUT_FILE_H
+
+#include <filesystem>     // path, rename, remove
+#include <format>         // format
+#include <fstream>        // ofstream
+#include <ostream>        // ostream
+#include <random>         // random_device
+#include <system_error>   // error_code, errc
+
+namespace neroll {
+
+namespace script {
+
+namespace detail {
+
+// writes `file` through `writer(std::ostream &)` into a temporary file
+// beside it, which then replaces it, so a reader mapping `file` never sees
+// it half written; on failure the temporary file is removed and the error
+// returned, an exception of `writer` removes it too
+template <class Writer>
+std::error_code write_atomically(const std::filesystem::path &file, Writer &&writer) {
+    std::filesystem::path temporary = file;
+    temporary += std::format(".{:08x}.tmp", std::random_device{}());
+    std::error_code error;
+    try {
+        std::ofstream fout(temporary, std::ios::binary);
+        writer(static_cast<std::ostream &>(fout));
+        if (!fout.flush()) {
+            fout.close();
+            std::filesystem::remove(temporary, error);
+            return std::make_error_code(std::errc::io_error);
+        }
+    } catch (...) {
+        std::filesystem::remove(temporary, error);
+        throw;
+    }
+    std::filesystem::rename(temporary, file, error);
+    if (error) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+    }
+    return error;
+}
+
+}
+
+}
+
+}
+
+#endif
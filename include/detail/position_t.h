@@ -1,7 +1,11 @@
 #ifndef NEROLL_SCRIPT_DETAIL_POSITION_T_H
 #define NEROLL_SCRIPT_DETAIL_POSITION_T_H
 
-#include <cstddef>  // size_t
+#include <algorithm>    // upper_bound, min, max
+#include <cstddef>      // size_t
+#include <cstring>      // memchr
+#include <string_view>  // string_view
+#include <vector>       // vector
 
 namespace neroll {
 
@@ -16,10 +20,64 @@ struct position_t {
     std::size_t lines_read = 0;
 };
 
+// offsets at which lines start, recorded as newlines are read or indexed
+// from the source when a position is asked for, so nothing is counted per
+// character
+class line_index {
+ public:
+    line_index() : starts_{0} {}
+
+    // for input that starts at `start`, e.g. a block cut out of a source,
+    // only the lines from there on are recorded
+    explicit line_index(const position_t &start)
+        : starts_{start.chars_read_total - start.chars_read_current_line},
+          first_line_(start.lines_read), indexed_(start.chars_read_total) {}
+
+    // `start` is the offset just past a '\n', lines seen before are ignored
+    void add_line(std::size_t start) {
+        if (start > starts_.back()) {
+            starts_.push_back(start);
+        }
+    }
+
+    // records the lines of `text`, which starts at offset `base`, up to
+    // offset `until`, text indexed before is skipped
+    void index(std::string_view text, std::size_t base, std::size_t until) {
+        std::size_t from = std::max(indexed_, base);
+        std::size_t to = std::min(until, base + text.size());
+        if (from >= to) {
+            return;
+        }
+        const char *p = text.data() + (from - base);
+        const char *end = text.data() + (to - base);
+        while ((p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr) {
+            ++p;
+            add_line(base + static_cast<std::size_t>(p - text.data()));
+        }
+        indexed_ = to;
+    }
+
+    // position after reading `offset` characters
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const noexcept {
+        std::size_t line = starts_.size() - 1;
+        if (offset < starts_.back()) {
+            line = static_cast<std::size_t>(std::upper_bound(starts_.begin(), starts_.end(), offset) - starts_.begin()) - 1;
+        }
+        return {offset, offset - starts_[line], first_line_ + line};
+    }
+
+ private:
+    std::vector<std::size_t> starts_;
+    // number of the line starts_[0] starts
+    std::size_t first_line_ = 0;
+    std::size_t indexed_ = 0;
+};
+
 }
 
 }
 
 }
 
-#endif
\ No newline at end of file
+#endif
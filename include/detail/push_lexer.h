@@ -0,0 +1,150 @@
+#ifndef NEROLL_SCRIPT_DETAIL_PUSH_LEXER_H
+#define NEROLL_SCRIPT_DETAIL_PUSH_LEXER_H
+
+#include <cstddef>      // size_t
+#include <exception>    // exception_ptr, current_exception, rethrow_exception
+#include <memory>       // shared_ptr
+#include <string>       // string
+#include <string_view>  // string_view
+#include <utility>      // move
+#include <vector>       // vector
+
+#include "input_adapter.h"  // span_input_adapter
+#include "lexer.h"          // lexer, token
+#include "position_t.h"     // position_t, line_index
+#include "symbol_table.h"   // symbol_table, string_pool
+
+namespace neroll::script::detail {
+
+// lexes input that arrives in chunks: feed() returns the tokens each chunk
+// completes and keeps the unfinished tail, e.g. the `1.` of `1.5` or the `<`
+// of `<<`, for the next one
+//
+// a lexer error is thrown once the tokens before it are returned, so the
+// same tokens come out as when lexing the whole source, every call after
+// it throws it again
+class push_lexer {
+ public:
+    explicit push_lexer(std::shared_ptr<symbol_table> symbols = std::make_shared<symbol_table>())
+        : symbols_(std::move(symbols)) {}
+
+    std::vector<token> feed(std::string_view chunk) {
+        rethrow_error();
+        buffer_.append(chunk);
+        std::vector<token> tokens;
+        lex(tokens, false);
+        if (tokens.empty()) {
+            rethrow_error();
+        }
+        return tokens;
+    }
+
+    // ends the input, returns the remaining tokens and end_of_input
+    std::vector<token> finish() {
+        rethrow_error();
+        std::vector<token> tokens;
+        lex(tokens, true);
+        if (tokens.empty()) {
+            rethrow_error();
+        }
+        return tokens;
+    }
+
+    [[nodiscard]]
+    position_t position() const noexcept {
+        return lines_.position_at(offset_);
+    }
+
+    // line and column of token::offset
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const noexcept {
+        return lines_.position_at(offset);
+    }
+
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return symbols_;
+    }
+
+ private:
+    std::shared_ptr<symbol_table> symbols_;
+    // input not lexed into a complete token yet
+    std::string buffer_;
+    // characters of complete tokens, counted from the first chunk
+    std::size_t offset_ = 0;
+    line_index lines_;
+    // token text, which must outlive buffer_ and the lexer
+    string_pool text_;
+    // the lexer error, thrown once the tokens before it are returned
+    std::exception_ptr error_;
+
+    void rethrow_error() const {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void lex(std::vector<token> &tokens, bool finished) {
+        lexer lex(span_input_adapter{std::string_view{buffer_}}, symbols_);
+        lex.resume(offset_, std::move(lines_));
+        std::size_t consumed = 0;
+        while (true) {
+            token tok;
+            try {
+                tok = lex.next_token();
+            } catch (...) {
+                // an unterminated string may still be closed by the next chunk
+                if (!finished && reached_end(lex)) {
+                    break;
+                }
+                error_ = std::current_exception();
+                break;
+            }
+            // every token peeks one character past its end, except single
+            // character ones, so a token touching the end may still grow
+            if (!finished && reached_end(lex)) {
+                break;
+            }
+            tokens.push_back(stabilize(tok));
+            consumed = lex.token_range().first + lex.token_range().second;
+            offset_ = lex.offset();
+            if (tok.type == token_type::end_of_input) {
+                break;
+            }
+        }
+        // lines of an unfinished tail are added again, and ignored, when
+        // it is lexed with the next chunk
+        lines_ = lex.release_lines();
+        buffer_.erase(0, consumed);
+    }
+
+    [[nodiscard]]
+    bool reached_end(const lexer<span_input_adapter> &lex) const noexcept {
+        auto [offset, length] = lex.token_range();
+        return offset + length == buffer_.size();
+    }
+
+    // repoints content that views buffer_ or the lexer's pool
+    token stabilize(token tok) {
+        switch (tok.type) {
+            case token_type::identifier:
+                tok.content = symbols_->name(tok.symbol);
+                break;
+            case token_type::literal_int:
+            case token_type::literal_float:
+            case token_type::literal_string:
+            case token_type::literal_interpolated:
+            case token_type::parse_error:
+                tok.content = text_.store(tok.content);
+                break;
+            default:
+                // keywords, operators and char literals view static spellings
+                break;
+        }
+        return tok;
+    }
+};
+
+}   // namespace neroll::script::detail
+
+#endif
@@ -0,0 +1,369 @@
+#ifndef NEROLL_SCRIPT_DETAIL_SCAN_H
+#define NEROLL_SCRIPT_DETAIL_SCAN_H
+
+#include <array>        // array
+#include <bit>          // countr_zero
+#include <cstddef>      // ptrdiff_t, size_t
+#include <cstdint>      // uint8_t, uint32_t
+
+#if defined(__AVX2__)
+#include <immintrin.h>  // _mm256_*
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEROLL_SCRIPT_HAS_SSE2
+#include <emmintrin.h>  // _mm_*
+#endif
+
+namespace neroll::script::detail {
+
+namespace char_class {
+
+constexpr std::uint8_t whitespace     = 1 << 0;     // ' ', '\t', '\r', '\n'
+constexpr std::uint8_t alpha          = 1 << 1;     // A-Z a-z
+constexpr std::uint8_t digit          = 1 << 2;     // 0-9
+constexpr std::uint8_t underscore     = 1 << 3;     // _
+constexpr std::uint8_t string_special = 1 << 4;     // '"', '\\', '\n'
+constexpr std::uint8_t non_ascii      = 1 << 5;     // bytes of UTF-8 sequences
+constexpr std::uint8_t identifier     = alpha | digit | underscore;
+
+}   // namespace char_class
+
+// replaces std::isalpha and friends, which are locale dependent calls
+constexpr std::array<std::uint8_t, 256> char_classes = [] {
+    using namespace char_class;
+    std::array<std::uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; c++) {
+        table[c] |= alpha;
+    }
+    for (int c = 'A'; c <= 'Z'; c++) {
+        table[c] |= alpha;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        table[c] |= digit;
+    }
+    table['_'] |= underscore;
+    table[' '] |= whitespace;
+    table['\t'] |= whitespace;
+    table['\r'] |= whitespace;
+    table['\n'] |= whitespace | string_special;
+    table['"'] |= string_special;
+    table['\\'] |= string_special;
+    for (int c = 0x80; c <= 0xFF; c++) {
+        table[c] |= non_ascii;
+    }
+    return table;
+}();
+
+// `c` is a character or eof, as returned by get_character()
+constexpr bool has_class(int c, std::uint8_t classes) noexcept {
+    return static_cast<unsigned>(c) < char_classes.size() && (char_classes[static_cast<unsigned>(c)] & classes) != 0;
+}
+
+namespace scan {
+
+// number of bytes of the UTF-8 sequence led by `lead`, 0 if no sequence
+// starts with it
+constexpr std::ptrdiff_t utf8_length(unsigned char lead) noexcept {
+    if (lead < 0x80) {
+        return 1;
+    }
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return 2;
+    }
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        return 3;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        return 4;
+    }
+    return 0;
+}
+
+// end of the UTF-8 sequence led by the non-ASCII byte at `p`, or nullptr if
+// it is not well formed (overlong, a surrogate, above U+10FFFF, truncated)
+inline const char *utf8_sequence_end(const char *p, const char *end) noexcept {
+    const auto lead = static_cast<unsigned char>(*p);
+    const std::ptrdiff_t length = utf8_length(lead);
+    if (length < 2 || end - p < length) {
+        return nullptr;
+    }
+    // only the second byte has a range narrower than 0x80-0xBF
+    const auto second = static_cast<unsigned char>(p[1]);
+    const unsigned char low = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+    const unsigned char high = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+    if (second < low || second > high) {
+        return nullptr;
+    }
+    for (std::ptrdiff_t i = 2; i < length; i++) {
+        if ((static_cast<unsigned char>(p[i]) & 0xC0) != 0x80) {
+            return nullptr;
+        }
+    }
+    return p + length;
+}
+
+// kernels over [p, end), each returns the first character outside the run
+// it scans for, or `end`
+
+namespace scalar {
+
+inline const char *skip_while(const char *p, const char *end, std::uint8_t classes) noexcept {
+    while (p != end && (char_classes[static_cast<unsigned char>(*p)] & classes) != 0) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char *find_any(const char *p, const char *end, std::uint8_t classes) noexcept {
+    while (p != end && (char_classes[static_cast<unsigned char>(*p)] & classes) == 0) {
+        ++p;
+    }
+    return p;
+}
+
+// next '"', '\\' or '\n', or the first byte that is not valid UTF-8
+inline const char *string_special(const char *p, const char *end) noexcept {
+    while (p != end) {
+        const auto c = static_cast<unsigned char>(*p);
+        if ((char_classes[c] & char_class::non_ascii) != 0) {
+            const char *next = utf8_sequence_end(p, end);
+            if (next == nullptr) {
+                return p;
+            }
+            p = next;
+        } else if ((char_classes[c] & char_class::string_special) != 0) {
+            return p;
+        } else {
+            ++p;
+        }
+    }
+    return p;
+}
+
+}   // namespace scalar
+
+#if defined(__AVX2__)
+
+inline __m256i whitespace_mask(__m256i chunk) noexcept {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+}
+
+constexpr std::ptrdiff_t block_size = 32;
+
+inline std::uint32_t top_bits(__m256i chunk) noexcept {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(chunk));
+}
+
+inline __m256i in_range(__m256i chunk, char low, char high) noexcept {
+    // bytes >= 0x80 compare as negative and fall outside every ASCII range
+    return _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(static_cast<char>(low - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)), chunk));
+}
+
+inline __m256i identifier_mask(__m256i chunk) noexcept {
+    __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(_mm256_or_si256(in_range(lower, 'a', 'z'), in_range(chunk, '0', '9')),
+                           _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+}
+
+inline __m256i string_special_mask(__m256i chunk) noexcept {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+}
+
+template <bool Skip, typename Mask>
+inline const char *search(const char *p, const char *end, Mask mask) noexcept {
+    while (end - p >= block_size) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto bits = top_bits(mask(chunk));
+        if constexpr (Skip) {
+            bits = ~bits;
+        }
+        if (bits != 0) {
+            return p + std::countr_zero(bits);
+        }
+        p += block_size;
+    }
+    return p;
+}
+
+inline __m256i load_block(const char *p) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+#elif defined(NEROLL_SCRIPT_HAS_SSE2)
+
+inline __m128i whitespace_mask(__m128i chunk) noexcept {
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+}
+
+constexpr std::ptrdiff_t block_size = 16;
+
+inline std::uint32_t top_bits(__m128i chunk) noexcept {
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(chunk));
+}
+
+inline __m128i in_range(__m128i chunk, char low, char high) noexcept {
+    // bytes >= 0x80 compare as negative and fall outside every ASCII range
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(static_cast<char>(low - 1))),
+                         _mm_cmplt_epi8(chunk, _mm_set1_epi8(static_cast<char>(high + 1))));
+}
+
+inline __m128i identifier_mask(__m128i chunk) noexcept {
+    __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    return _mm_or_si128(_mm_or_si128(in_range(lower, 'a', 'z'), in_range(chunk, '0', '9')),
+                        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+}
+
+inline __m128i string_special_mask(__m128i chunk) noexcept {
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+}
+
+template <bool Skip, typename Mask>
+inline const char *search(const char *p, const char *end, Mask mask) noexcept {
+    while (end - p >= block_size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto bits = top_bits(mask(chunk));
+        if constexpr (Skip) {
+            bits ^= 0xFFFF;
+        }
+        if (bits != 0) {
+            return p + std::countr_zero(bits);
+        }
+        p += block_size;
+    }
+    return p;
+}
+
+inline __m128i load_block(const char *p) noexcept {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+#endif
+
+inline const char *skip_whitespace(const char *p, const char *end) noexcept {
+#if defined(__AVX2__) || defined(NEROLL_SCRIPT_HAS_SSE2)
+    // indentation is usually short, try a few characters before a vector load
+    for (int i = 0; i < 4 && p != end; i++, p++) {
+        if (!has_class(static_cast<unsigned char>(*p), char_class::whitespace)) {
+            return p;
+        }
+    }
+    p = search<true>(p, end, [](auto chunk) { return whitespace_mask(chunk); });
+#endif
+    return scalar::skip_while(p, end, char_class::whitespace);
+}
+
+// identifiers may contain any non-ASCII code point, stops at the first byte
+// that is not valid UTF-8 as well
+inline const char *identifier_end(const char *p, const char *end) noexcept {
+    while (true) {
+#if defined(__AVX2__) || defined(NEROLL_SCRIPT_HAS_SSE2)
+        p = search<true>(p, end, [](auto chunk) { return identifier_mask(chunk); });
+#endif
+        p = scalar::skip_while(p, end, char_class::identifier);
+        if (p == end || !has_class(static_cast<unsigned char>(*p), char_class::non_ascii)) {
+            return p;
+        }
+        const char *next = utf8_sequence_end(p, end);
+        if (next == nullptr) {
+            return p;
+        }
+        p = next;
+    }
+}
+
+// next '"', '\\' or '\n' inside a string literal, or the first byte that is
+// not valid UTF-8, blocks of ASCII cost one extra test and only the others
+// are decoded
+inline const char *string_special(const char *p, const char *end) noexcept {
+#if defined(__AVX2__) || defined(NEROLL_SCRIPT_HAS_SSE2)
+    while (end - p >= block_size) {
+        auto chunk = load_block(p);
+        std::uint32_t special = top_bits(string_special_mask(chunk));
+        // the top bit of a byte is set exactly for non-ASCII bytes
+        if (top_bits(chunk) != 0) [[unlikely]] {
+            // specials are ASCII and never inside a sequence
+            const char *stop = special != 0 ? p + std::countr_zero(special) : p + block_size;
+            while (p < stop) {
+                if (static_cast<unsigned char>(*p) < 0x80) {
+                    ++p;
+                    continue;
+                }
+                const char *next = utf8_sequence_end(p, end);
+                if (next == nullptr) {
+                    return p;
+                }
+                p = next;
+            }
+            if (special != 0) {
+                return stop;
+            }
+            continue;
+        }
+        if (special != 0) {
+            return p + std::countr_zero(special);
+        }
+        p += block_size;
+    }
+#endif
+    return scalar::string_special(p, end);
+}
+
+// just past the '}' closing the block whose '{' is at `p`, string and char
+// literals are stepped over as the lexer reads them, nullptr when the input
+// ends first or a literal is malformed, which only lexing can report
+inline const char *block_end(const char *p, const char *end) noexcept {
+    std::size_t depth = 0;
+    while (p != end) {
+        switch (*p++) {
+            case '{':
+                depth++;
+                break;
+            case '}':
+                if (--depth == 0) {
+                    return p;
+                }
+                break;
+            case '"':
+                while (true) {
+                    p = string_special(p, end);
+                    if (p == end || (*p != '"' && *p != '\\')) {
+                        return nullptr;
+                    }
+                    if (*p++ == '"') {
+                        break;
+                    }
+                    // the escaped character
+                    if (p == end || *p == '\n') {
+                        return nullptr;
+                    }
+                    ++p;
+                }
+                break;
+            case '\'':
+                // exactly one character between the quotes
+                if (end - p < 2 || p[0] == '\'' || p[1] != '\'') {
+                    return nullptr;
+                }
+                p += 2;
+                break;
+            default:
+                break;
+        }
+    }
+    return nullptr;
+}
+
+}   // namespace scan
+
+}   // namespace neroll::script::detail
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef NEROLL_SCRIPT_DETAIL_SPSC_QUEUE_H
+#define NEROLL_SCRIPT_DETAIL_SPSC_QUEUE_H
+
+#include <array>        // array
+#include <atomic>       // atomic
+#include <bit>          // has_single_bit
+#include <cstddef>      // size_t
+#include <stop_token>   // stop_token
+
+namespace neroll::script::detail {
+
+// not hardware_destructive_interference_size, which changes with the
+// compiler flags and is warned about for that
+constexpr std::size_t cache_line_size = 64;
+
+// bounded lock-free queue between exactly one producer and one consumer
+// thread, elements are filled and read in place in their slots
+template <typename T, std::size_t Capacity>
+    requires (std::has_single_bit(Capacity))
+class spsc_queue {
+ public:
+    spsc_queue() = default;
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    [[nodiscard]]
+    constexpr std::size_t capacity() const noexcept {
+        return Capacity;
+    }
+
+    // producer: the slot to fill next, nullptr if the queue is full
+    [[nodiscard]]
+    T *back() noexcept {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == Capacity) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == Capacity) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail % Capacity];
+    }
+
+    // producer: hands the slot returned by back() to the consumer
+    void push() noexcept {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    // producer: blocks until back() has a slot or a stop is requested,
+    // returns whether there is a slot
+    bool wait_for_space(std::stop_token stop) noexcept {
+        while (true) {
+            const std::size_t head = head_.load(std::memory_order_acquire);
+            if (tail_.load(std::memory_order_relaxed) - head < Capacity) {
+                return true;
+            }
+            if (stop.stop_requested()) {
+                return false;
+            }
+            head_.wait(head, std::memory_order_acquire);
+        }
+    }
+
+    // consumer: the oldest element, nullptr if the queue is empty
+    [[nodiscard]]
+    T *front() noexcept {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head % Capacity];
+    }
+
+    // consumer: gives the slot returned by front() back to the producer
+    void pop() noexcept {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        head_.notify_one();
+    }
+
+    // consumer: blocks until front() has an element
+    void wait_for_element() noexcept {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        tail_.wait(head, std::memory_order_acquire);
+    }
+
+ private:
+    // each index on a cache line of its own, next to the copy of the other
+    // index its owner reads, so the threads do not share lines needlessly
+    alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+    alignas(cache_line_size) std::array<T, Capacity> slots_{};
+};
+
+}   // namespace neroll::script::detail
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef NEROLL_SCRIPT_DETAIL_SYMBOL_TABLE_H
+#define NEROLL_SCRIPT_DETAIL_SYMBOL_TABLE_H
+
+#include <algorithm>        // max, copy_n
+#include <array>            // array
+#include <cassert>          // assert
+#include <cstddef>          // size_t
+#include <cstdint>          // uint32_t
+#include <limits>           // numeric_limits
+#include <memory>           // unique_ptr
+#include <string_view>      // string_view
+#include <unordered_map>    // unordered_map
+#include <utility>          // move
+#include <vector>           // vector
+
+namespace neroll::script::detail {
+
+// keeps copies of strings at stable addresses until it is destroyed
+class string_pool {
+ public:
+    constexpr static std::size_t chunk_size = 16 * 1024;
+
+    std::string_view store(std::string_view str) {
+        append(str);
+        return commit();
+    }
+
+    // builds a string in place, it is moved to a new chunk if it outgrows
+    // the current one and becomes stable once commit() returns it
+    void append(std::string_view str) {
+        if (str.size() > remaining_) {
+            grow(open_size_ + str.size());
+        }
+        std::copy_n(str.data(), str.size(), next_);
+        next_ += str.size();
+        remaining_ -= str.size();
+        open_size_ += str.size();
+    }
+
+    void append(char c) {
+        append(std::string_view{&c, 1});
+    }
+
+    std::string_view commit() noexcept {
+        std::string_view result{next_ - open_size_, open_size_};
+        open_size_ = 0;
+        return result;
+    }
+
+ private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *next_ = nullptr;
+    std::size_t remaining_ = 0;
+    // length of the string being built by append()
+    std::size_t open_size_ = 0;
+
+    void grow(std::size_t size) {
+        // a string that keeps growing doubles, so appending stays linear
+        size = std::max(chunk_size, open_size_ == 0 ? size : 2 * size);
+        auto chunk = std::make_unique<char[]>(size);
+        std::copy_n(next_ - open_size_, open_size_, chunk.get());
+        next_ = chunk.get() + open_size_;
+        remaining_ = size - open_size_;
+        chunks_.push_back(std::move(chunk));
+    }
+};
+
+using symbol_id = std::uint32_t;
+
+constexpr symbol_id no_symbol = std::numeric_limits<symbol_id>::max();
+
+// interned in this order, so the id of a keyword equals the value of its
+// token_type
+constexpr std::array<std::string_view, 14> reserved_words{
+    "int", "float", "boolean", "string", "char", "function", "if",
+    "else", "for", "while", "continue", "break", "return", "new"
+};
+
+// maps names to 32-bit ids, so identifiers compare as integers
+class symbol_table {
+ public:
+    symbol_table() {
+        for (std::string_view word : reserved_words) {
+            intern(word);
+        }
+    }
+
+    symbol_table(const symbol_table&) = delete;
+    symbol_table& operator=(const symbol_table&) = delete;
+
+    symbol_id intern(std::string_view name) {
+        auto iter = ids_.find(name);
+        if (iter != ids_.end()) {
+            return iter->second;
+        }
+        std::string_view stored = pool_.store(name);
+        auto id = static_cast<symbol_id>(names_.size());
+        names_.push_back(stored);
+        ids_.emplace(stored, id);
+        return id;
+    }
+
+    [[nodiscard]]
+    symbol_id find(std::string_view name) const {
+        auto iter = ids_.find(name);
+        return iter == ids_.end() ? no_symbol : iter->second;
+    }
+
+    [[nodiscard]]
+    std::string_view name(symbol_id id) const noexcept {
+        assert(id < names_.size());
+        return names_[id];
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return names_.size();
+    }
+
+ private:
+    string_pool pool_;
+    std::vector<std::string_view> names_;
+    std::unordered_map<std::string_view, symbol_id> ids_;
+};
+
+}   // namespace neroll::script::detail
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef NEROLL_SCRIPT_DETAIL_TOKEN_PIPELINE_H
+#define NEROLL_SCRIPT_DETAIL_TOKEN_PIPELINE_H
+
+#include <array>            // array
+#include <cstddef>          // size_t
+#include <exception>        // exception_ptr, current_exception, rethrow_exception
+#include <memory>           // shared_ptr, unique_ptr, make_unique
+#include <stop_token>       // stop_token
+#include <string_view>      // string_view
+#include <thread>           // jthread
+#include <utility>          // move
+
+#include "input_adapter.h"  // contiguous_input_adapter
+#include "lexer.h"          // lexer, token
+#include "position_t.h"     // position_t, line_index
+#include "ring_buffer.h"    // ring_buffer
+#include "spsc_queue.h"     // spsc_queue
+#include "symbol_table.h"   // symbol_table
+#include "token_source.h"   // look_ahead_count
+
+namespace neroll::script::detail {
+
+// asks the parser to lex on a thread of its own:
+//   parser psr{pipelined{lexer{mmap_input_adapter{file}}}};
+template <typename InputAdapter>
+struct pipelined {
+    lexer<InputAdapter> source;
+};
+
+template <typename InputAdapter>
+pipelined(lexer<InputAdapter> &&) -> pipelined<InputAdapter>;
+
+// tokens lexed in one go by the producer, a lexer error ends the batch
+struct token_batch {
+    constexpr static std::size_t capacity = 256;
+
+    std::array<token, capacity> tokens;
+    std::size_t size = 0;
+    std::exception_ptr error;
+    // the producer stops after this batch
+    bool last = false;
+};
+
+// lexes on a producer thread while the parser consumes the tokens, which
+// are passed over in batches through a single-producer single-consumer
+// queue, a lexer error is thrown by the same advance() that
+// lexer_token_source would throw it from
+template <typename InputAdapter>
+    requires contiguous_input_adapter<InputAdapter>
+class pipelined_token_source {
+ public:
+    pipelined_token_source(pipelined<InputAdapter> &&input)
+        : shared_(std::make_unique<shared_state>(std::move(input.source))),
+          source_(shared_->lex.source()),
+          producer_([state = shared_.get()](std::stop_token stop) { produce(*state, stop); }) {
+        for (std::size_t i = 0; i < buffer_.capacity(); i++) {
+            advance();
+        }
+    }
+
+    pipelined_token_source(pipelined_token_source &&) = default;
+    pipelined_token_source &operator=(pipelined_token_source &&) = delete;
+
+    ~pipelined_token_source() {
+        if (!producer_.joinable()) {
+            return;
+        }
+        producer_.request_stop();
+        // a producer waiting for space wakes up and sees the request
+        if (shared_->queue.front() != nullptr) {
+            shared_->queue.pop();
+        }
+        producer_.join();
+    }
+
+    [[nodiscard]]
+    const token &peek(std::size_t distance) const noexcept {
+        return buffer_.get_next(distance);
+    }
+
+    [[nodiscard]]
+    token_type peek_type(std::size_t distance) const noexcept {
+        return buffer_.get_next(distance).type;
+    }
+
+    void advance() {
+        buffer_.put(next_token());
+    }
+
+    // where the lexer would be, just past the last token looked ahead at
+    [[nodiscard]]
+    position_t position() const {
+        const std::size_t offset = peek(look_ahead_count - 1).offset;
+        lines_.index(source_, 0, offset);
+        return lines_.position_at(offset);
+    }
+
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const {
+        lines_.index(source_, 0, offset);
+        return lines_.position_at(offset);
+    }
+
+    // the producer interns while it runs, names are safe to read once
+    // end_of_input has been peeked
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return shared_->lex.symbols();
+    }
+
+ private:
+    constexpr static std::size_t queue_capacity = 16;
+
+    struct shared_state {
+        lexer<InputAdapter> lex;
+        spsc_queue<token_batch, queue_capacity> queue;
+    };
+
+    std::unique_ptr<shared_state> shared_;
+    std::string_view source_;
+    ring_buffer<token, look_ahead_count> buffer_;
+    // batch being read, stays in the queue until it has been read
+    token_batch *batch_ = nullptr;
+    std::size_t read_ = 0;
+    std::size_t last_offset_ = 0;
+    mutable line_index lines_;
+    // declared last, so it starts after everything it uses
+    std::jthread producer_;
+
+    static void produce(shared_state &state, std::stop_token stop) {
+        while (!stop.stop_requested() && state.queue.wait_for_space(stop)) {
+            token_batch &batch = *state.queue.back();
+            batch.size = 0;
+            batch.error = nullptr;
+            batch.last = false;
+            try {
+                while (batch.size < token_batch::capacity) {
+                    const token tok = state.lex.next_token();
+                    batch.tokens[batch.size++] = tok;
+                    if (tok.type == token_type::end_of_input) {
+                        batch.last = true;
+                        break;
+                    }
+                }
+            } catch (...) {
+                batch.error = std::current_exception();
+                batch.last = true;
+            }
+            // the batch belongs to the consumer once pushed
+            const bool last = batch.last;
+            state.queue.push();
+            if (last) {
+                return;
+            }
+        }
+    }
+
+    token next_token() {
+        while (true) {
+            if (batch_ == nullptr) {
+                while ((batch_ = shared_->queue.front()) == nullptr) {
+                    shared_->queue.wait_for_element();
+                }
+                read_ = 0;
+            }
+            if (read_ < batch_->size) {
+                last_offset_ = batch_->tokens[read_].offset;
+                return batch_->tokens[read_++];
+            }
+            if (batch_->error) {
+                std::rethrow_exception(batch_->error);
+            }
+            if (batch_->last) {
+                // the lexer reads one more character at each eof
+                return token{"eof", token_type::end_of_input, ++last_offset_};
+            }
+            shared_->queue.pop();
+            batch_ = nullptr;
+        }
+    }
+};
+
+}   // namespace neroll::script::detail
+
+#endif
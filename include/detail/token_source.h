@@ -0,0 +1,110 @@
+#ifndef NEROLL_SCRIPT_DETAIL_TOKEN_SOURCE_H
+#define NEROLL_SCRIPT_DETAIL_TOKEN_SOURCE_H
+
+#include <cassert>      // assert
+#include <concepts>     // convertible_to, same_as
+#include <cstddef>      // size_t
+#include <memory>       // shared_ptr
+#include <optional>     // optional, nullopt
+#include <string_view>  // string_view
+#include <utility>      // move
+
+#include "lexer.h"          // lexer, token
+#include "position_t.h"     // position_t
+#include "ring_buffer.h"    // ring_buffer
+#include "symbol_table.h"   // symbol_table
+
+namespace neroll::script::detail {
+
+// number of tokens the parser looks ahead
+constexpr std::size_t look_ahead_count = 2;
+
+// what the parser reads tokens from:
+//   peek(n) / peek_type(n)  the n-th token after the current one
+//   advance()               drop the current token
+//   position()              where syntax errors are reported
+//   position_at(offset)     line and column of an offset read, e.g. token::start
+template <typename T>
+concept token_source = requires(T &source, const T &const_source, std::size_t distance) {
+    { const_source.peek(distance) } -> std::convertible_to<token>;
+    { const_source.peek_type(distance) } -> std::same_as<token_type>;
+    { source.advance() };
+    { const_source.position() } -> std::convertible_to<position_t>;
+    { const_source.position_at(distance) } -> std::convertible_to<position_t>;
+};
+
+// source text of a block skipped without lexing it, `position` is where it
+// starts and `end` the offset just past it
+struct skipped_block {
+    std::string_view text;
+    position_t position;
+    std::size_t end;
+};
+
+// lexes on demand, keeping the look-ahead tokens in a ring buffer
+template <typename InputAdapter>
+class lexer_token_source {
+ public:
+    lexer_token_source(lexer<InputAdapter> &&lexer)
+        : lexer_(std::move(lexer)) {
+        for (std::size_t i = 0; i < buffer_.capacity(); i++) {
+            advance();
+        }
+    }
+
+    [[nodiscard]]
+    const token &peek(std::size_t distance) const noexcept {
+        return buffer_.get_next(distance);
+    }
+
+    [[nodiscard]]
+    token_type peek_type(std::size_t distance) const noexcept {
+        return buffer_.get_next(distance).type;
+    }
+
+    void advance() {
+        buffer_.put(lexer_.next_token());
+    }
+
+    [[nodiscard]]
+    position_t position() const {
+        return lexer_.position();
+    }
+
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const {
+        return lexer_.position_at(offset);
+    }
+
+    // skips the block opened by the current token, its text views the
+    // input, nothing when its end is not found by brace matching, e.g. at
+    // a malformed literal, so the block must be lexed to report the error
+    std::optional<skipped_block> skip_block()
+        requires contiguous_input_adapter<InputAdapter> {
+        assert(peek_type(0) == token_type::left_brace);
+        const std::size_t open = peek(0).offset - 1;
+        const std::size_t end = lexer_.block_end(open);
+        if (end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        skipped_block block{lexer_.slice(open, end), lexer_.position_at(open), end};
+        lexer_.seek(end);
+        for (std::size_t i = 0; i < buffer_.capacity(); i++) {
+            advance();
+        }
+        return block;
+    }
+
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return lexer_.symbols();
+    }
+
+ private:
+    lexer<InputAdapter> lexer_;
+    ring_buffer<token, look_ahead_count> buffer_;
+};
+
+}   // namespace neroll::script::detail
+
+#endif
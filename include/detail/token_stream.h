@@ -0,0 +1,425 @@
+#ifndef NEROLL_SCRIPT_DETAIL_TOKEN_STREAM_H
+#define NEROLL_SCRIPT_DETAIL_TOKEN_STREAM_H
+
+#include <algorithm>        // min, max
+#include <cassert>          // assert
+#include <cstddef>          // size_t
+#include <cstdint>          // uint32_t
+#include <exception>        // exception_ptr, rethrow_exception
+#include <limits>           // numeric_limits
+#include <memory>           // shared_ptr
+#include <string>           // string
+#include <string_view>      // string_view
+#include <thread>           // jthread
+#include <unordered_map>    // unordered_map
+#include <utility>          // move, pair
+#include <vector>           // vector
+
+#include "input_adapter.h"  // contiguous_input_adapter
+#include "lexer.h"          // lexer, token
+#include "position_t.h"     // position_t, line_index
+#include "symbol_table.h"   // symbol_table, string_pool
+#include "token_source.h"   // look_ahead_count
+
+namespace neroll::script::detail {
+
+// content of a token as it appears in the source
+inline std::string_view source_content(std::string_view source, token_type type,
+                                       std::size_t offset, std::size_t length) noexcept {
+    switch (type) {
+        case token_type::literal_char:
+            return source.substr(offset + 1, 1);
+        case token_type::literal_string:
+            // without the quotes
+            return source.substr(offset + 1, length - 2);
+        case token_type::literal_interpolated:
+            return source.substr(offset + 2, length - 3);
+        case token_type::end_of_input:
+            return "eof";
+        default:
+            return source.substr(offset, length);
+    }
+}
+
+// tokens of a part of a source, lexed on a thread of its own
+struct lexed_chunk {
+    std::vector<token_type> types;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+    // content that is not the source text, by index in the chunk
+    std::vector<std::pair<std::uint32_t, std::string>> rewritten;
+    // identifiers in order of first appearance in the chunk
+    std::shared_ptr<symbol_table> symbols = std::make_shared<symbol_table>();
+    std::size_t begin = 0;
+    // offset after the last token
+    std::size_t end = 0;
+    // lexing threw at a token starting in the chunk
+    bool failed = false;
+};
+
+// lexes the tokens of `source` starting in [begin, stop), the last of which
+// may run past `stop`, a chunk reaching the end of the source has `stop`
+// npos and ends with end_of_input
+inline lexed_chunk lex_chunk(std::string_view source, std::size_t begin, std::size_t stop) {
+    lexed_chunk chunk;
+    chunk.begin = begin;
+    chunk.end = begin;
+    lexer lex(span_input_adapter{source.substr(begin)}, chunk.symbols);
+    lex.resume(begin, line_index{});
+    // the same guess of one token per 4 bytes as lexing on one thread
+    const std::size_t guess = (std::min(stop, source.size()) - begin) / 4;
+    chunk.types.reserve(guess);
+    chunk.offsets.reserve(guess);
+    chunk.lengths.reserve(guess);
+    while (true) {
+        token tok;
+        try {
+            tok = lex.next_token();
+        } catch (...) {
+            // the message is rebuilt with the right line if this is the
+            // error the whole source stops at
+            chunk.failed = begin + lex.token_range().first < stop;
+            break;
+        }
+        auto [offset, length] = lex.token_range();
+        offset += begin;
+        if (offset >= stop) {
+            break;
+        }
+        if (tok.content != source_content(source, tok.type, offset, length)) {
+            chunk.rewritten.emplace_back(static_cast<std::uint32_t>(chunk.types.size()), tok.content);
+        }
+        chunk.types.push_back(tok.type);
+        chunk.offsets.push_back(static_cast<std::uint32_t>(offset));
+        chunk.lengths.push_back(static_cast<std::uint32_t>(length));
+        chunk.end = lex.offset();
+        if (tok.type == token_type::end_of_input) {
+            break;
+        }
+    }
+    return chunk;
+}
+
+// starts of at most `count` parts of `source` of about the same size, every
+// one but the first right after a newline
+inline std::vector<std::size_t> split_at_lines(std::string_view source, std::size_t count) {
+    std::vector<std::size_t> starts{0};
+    for (std::size_t i = 1; i < count; i++) {
+        std::size_t newline = source.find('\n', std::max(source.size() * i / count, starts.back()));
+        if (newline == std::string_view::npos || newline + 1 == source.size()) {
+            break;
+        }
+        starts.push_back(newline + 1);
+    }
+    return starts;
+}
+
+// a whole source lexed up front, stored as parallel arrays of token type,
+// source offset and source length (9 bytes per token), tokens are rebuilt
+// on access
+template <typename InputAdapter>
+    requires contiguous_input_adapter<InputAdapter>
+class token_stream {
+ public:
+    // with more than one thread the source is split at newlines and the
+    // parts are lexed in parallel, the tokens, positions and errors are the
+    // same as lexing on one
+    explicit token_stream(lexer<InputAdapter> &&lexer, std::size_t threads = 1)
+        : lexer_(std::move(lexer)), source_(lexer_.source()) {
+        if (source_.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw_syntax_error("source of {} bytes is too large", source_.size());
+        }
+        if (threads > 1) {
+            lex_parallel(threads);
+        } else {
+            lex_all();
+        }
+    }
+
+    token_stream(const token_stream&) = delete;
+    token_stream& operator=(const token_stream&) = delete;
+    token_stream(token_stream&&) = default;
+
+    // number of tokens, the last one is end_of_input or, if lexing
+    // failed, parse_error
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return types_.size();
+    }
+
+    [[nodiscard]]
+    token_type type(std::size_t index) const noexcept {
+        assert(index < size());
+        return types_[index];
+    }
+
+    [[nodiscard]]
+    std::size_t offset(std::size_t index) const noexcept {
+        assert(index < size());
+        return offsets_[index];
+    }
+
+    [[nodiscard]]
+    std::string_view content(std::size_t index) const {
+        assert(index < size());
+        if (!rewritten_.empty()) {
+            auto iter = rewritten_.find(static_cast<std::uint32_t>(index));
+            if (iter != rewritten_.end()) {
+                return iter->second;
+            }
+        }
+        return source_content(source_, types_[index], offsets_[index], lengths_[index]);
+    }
+
+    [[nodiscard]]
+    token at(std::size_t index) const {
+        token tok = rebuild(index);
+        tok.start = offsets_[index];
+        return tok;
+    }
+
+    // offset after the last character of a token, as the lexer reports it
+    [[nodiscard]]
+    std::size_t end_offset(std::size_t index) const noexcept {
+        assert(index < size());
+        if (index == size() - 1) {
+            return last_offset_;
+        }
+        return offsets_[index] + lengths_[index];
+    }
+
+    [[nodiscard]]
+    position_t end_position(std::size_t index) const {
+        return lexer_.position_at(end_offset(index));
+    }
+
+    // line and column of an offset, e.g. token::offset
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const {
+        return lexer_.position_at(offset);
+    }
+
+    // rethrows the lexer error stored in place of the last token, if any
+    void check(std::size_t index) const {
+        if (error_ && index >= size() - 1) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return lexer_.symbols();
+    }
+
+ private:
+    lexer<InputAdapter> lexer_;
+    std::string_view source_;
+    std::vector<token_type> types_;
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::uint32_t> lengths_;
+    // tokens whose content is not their source text, e.g. strings with escapes
+    std::unordered_map<std::uint32_t, std::string_view> rewritten_;
+    // rewritten content of tokens lexed in parallel
+    string_pool text_;
+    std::size_t last_offset_ = 0;
+    std::exception_ptr error_;
+
+    [[nodiscard]]
+    token rebuild(std::size_t index) const {
+        std::string_view text = content(index);
+        if (types_[index] == token_type::literal_int) {
+            std::int32_t value{};
+            decode_number(text, value);
+            return {text, types_[index], number_t{value}, end_offset(index)};
+        }
+        if (types_[index] == token_type::literal_float) {
+            double value{};
+            decode_number(text, value);
+            return {text, types_[index], number_t{value}, end_offset(index)};
+        }
+        symbol_id symbol = no_symbol;
+        if (types_[index] == token_type::identifier) {
+            symbol = lexer_.symbols()->find(text);
+        } else if (types_[index] <= token_type::keyword_new) {
+            symbol = static_cast<symbol_id>(types_[index]);
+        }
+        return {text, types_[index], symbol, end_offset(index)};
+    }
+
+    void lex_all() {
+        // a rough guess of one token per 4 bytes avoids most regrowth
+        reserve(source_.size() / 4);
+        while (true) {
+            token tok;
+            try {
+                tok = lexer_.next_token();
+            } catch (...) {
+                // reported once the parser reaches this point
+                error_ = std::current_exception();
+                push(token_type::parse_error, lexer_.token_range().first, 0);
+                last_offset_ = lexer_.offset();
+                break;
+            }
+            auto [offset, length] = lexer_.token_range();
+            push(tok.type, offset, length);
+            if (tok.type == token_type::end_of_input) {
+                last_offset_ = lexer_.offset();
+                break;
+            }
+            if (tok.content != source_content(source_, tok.type, offset, length)) {
+                rewritten_.emplace(static_cast<std::uint32_t>(types_.size() - 1), tok.content);
+            }
+        }
+        types_.shrink_to_fit();
+        offsets_.shrink_to_fit();
+        lengths_.shrink_to_fit();
+    }
+
+    void lex_parallel(std::size_t threads) {
+        const std::vector<std::size_t> starts = split_at_lines(source_, threads);
+        auto stop = [&](std::size_t i) {
+            return i + 1 < starts.size() ? starts[i + 1] : std::string_view::npos;
+        };
+        std::vector<lexed_chunk> chunks(starts.size());
+        {
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 0; i < starts.size(); i++) {
+                workers.emplace_back([&, i] { chunks[i] = lex_chunk(source_, starts[i], stop(i)); });
+            }
+        }
+        std::size_t count = 0;
+        for (const lexed_chunk &chunk : chunks) {
+            count += chunk.types.size();
+        }
+        reserve(count + 1);
+        std::size_t end = 0;
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            // a token of the previous chunk ran into this one, e.g. a char
+            // literal holding a newline, so it was split inside a token
+            if (chunks[i].begin < end) {
+                chunks[i] = lex_chunk(source_, end, stop(i));
+            }
+            append(chunks[i]);
+            if (chunks[i].failed) {
+                relex_error(chunks[i].begin);
+                break;
+            }
+            end = chunks[i].end;
+        }
+        if (!error_) {
+            last_offset_ = end;
+        }
+        types_.shrink_to_fit();
+        offsets_.shrink_to_fit();
+        lengths_.shrink_to_fit();
+    }
+
+    void append(const lexed_chunk &chunk) {
+        const auto base = static_cast<std::uint32_t>(types_.size());
+        types_.insert(types_.end(), chunk.types.begin(), chunk.types.end());
+        offsets_.insert(offsets_.end(), chunk.offsets.begin(), chunk.offsets.end());
+        lengths_.insert(lengths_.end(), chunk.lengths.begin(), chunk.lengths.end());
+        for (const auto &[index, content] : chunk.rewritten) {
+            rewritten_.emplace(base + index, text_.store(content));
+        }
+        // in chunk order, so ids are given out as lexing on one thread would
+        const std::shared_ptr<symbol_table> &symbols = lexer_.symbols();
+        for (symbol_id id = 0; id < chunk.symbols->size(); id++) {
+            symbols->intern(chunk.symbols->name(id));
+        }
+    }
+
+    // lexes from `begin` again with the lines before it indexed, to get the
+    // error message the lexer on one thread would give
+    void relex_error(std::size_t begin) {
+        line_index lines;
+        lines.index(source_, 0, begin);
+        lexer lex(span_input_adapter{source_.substr(begin)}, std::make_shared<symbol_table>());
+        lex.resume(begin, std::move(lines));
+        try {
+            while (lex.next_token().type != token_type::end_of_input) {}
+        } catch (...) {
+            error_ = std::current_exception();
+            push(token_type::parse_error, begin + lex.token_range().first, 0);
+            last_offset_ = lex.offset();
+        }
+    }
+
+    void reserve(std::size_t count) {
+        types_.reserve(count);
+        offsets_.reserve(count);
+        lengths_.reserve(count);
+    }
+
+    void push(token_type type, std::size_t offset, std::size_t length) {
+        types_.push_back(type);
+        offsets_.push_back(static_cast<std::uint32_t>(offset));
+        lengths_.push_back(static_cast<std::uint32_t>(length));
+    }
+};
+
+// reads a token_stream by index, any distance can be looked ahead
+template <typename InputAdapter>
+class stream_token_source {
+ public:
+    stream_token_source(token_stream<InputAdapter> &&stream)
+        : stream_(std::move(stream)) {
+        stream_.check(look_ahead_count - 1);
+    }
+
+    [[nodiscard]]
+    token peek(std::size_t distance) const {
+        return stream_.at(index(distance));
+    }
+
+    [[nodiscard]]
+    token_type peek_type(std::size_t distance) const noexcept {
+        return stream_.type(index(distance));
+    }
+
+    void advance() {
+        if (cursor_ < stream_.size() - 1) {
+            cursor_++;
+        }
+        // same point the on-demand lexer would have thrown at
+        stream_.check(cursor_ + look_ahead_count - 1);
+    }
+
+    [[nodiscard]]
+    position_t position() const {
+        return stream_.end_position(index(look_ahead_count - 1));
+    }
+
+    [[nodiscard]]
+    position_t position_at(std::size_t offset) const {
+        return stream_.position_at(offset);
+    }
+
+    [[nodiscard]]
+    std::size_t cursor() const noexcept {
+        return cursor_;
+    }
+
+    [[nodiscard]]
+    const token_stream<InputAdapter> &stream() const noexcept {
+        return stream_;
+    }
+
+    [[nodiscard]]
+    const std::shared_ptr<symbol_table> &symbols() const noexcept {
+        return stream_.symbols();
+    }
+
+ private:
+    token_stream<InputAdapter> stream_;
+    std::size_t cursor_ = 0;
+
+    [[nodiscard]]
+    std::size_t index(std::size_t distance) const noexcept {
+        return std::min(cursor_ + distance, stream_.size() - 1);
+    }
+};
+
+}   // namespace neroll::script::detail
+
+#endif
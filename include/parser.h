@@ -1,78 +1,307 @@
 #ifndef NEROLL_SCRIPT_PARSER_H
 #define NEROLL_SCRIPT_PARSER_H
 
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <initializer_list>
 #include <memory>
+#include <optional>
 #include <print>
+#include <span>
 #include <string>
 #include <utility>
+#include <vector>
+#include "detail/arena.h"
 #include "detail/array.h"
 #include "detail/ast.h"
+#include "detail/hash_cons.h"
 #include "detail/lexer.h"
-#include "detail/ring_buffer.h"
+#include "detail/token_pipeline.h"
+#include "detail/token_source.h"
+#include "detail/token_stream.h"
 #include "exception.h"
+#include "program.h"
 #include "variable.h"
 
 namespace neroll::script {
 
 using namespace detail;
 
+// how many expression nodes a parser was asked for, and how many of them
+// are a node made before for the same expression
+struct parse_stats {
+    std::size_t expressions = 0;
+    std::size_t shared = 0;
+};
+
+// what a parser shares with the parsers it starts for the holes of
+// interpolated strings and for deferred function bodies, which may run
+// after it is gone
+struct parse_context {
+    std::size_t max_depth;
+    // expression nodes by structure, while hash consing
+    std::optional<hash_cons_table> hash_cons;
+    parse_stats stats;
+};
+
+template <token_source TokenSource>
 class parser {
  public:
-    parser(detail::lexer &&lexer)
-        : lexer_(std::move(lexer)) {
-        for (std::size_t i = 0; i < buffer_.capacity(); i++) {
-            get_token();
+    // nodes go to `nodes`, which may be shared with other parsers made on
+    // the same thread, e.g. a batch of scripts loaded together
+    template <typename Input>
+        requires std::constructible_from<TokenSource, Input>
+    parser(Input &&input, std::shared_ptr<arena> nodes = std::make_shared<arena>())
+        : tokens_(std::forward<Input>(input)), nodes_(std::move(nodes)) {}
+
+    // the top-level statements up to the end of input
+    program parse() {
+        std::vector<statement_extent> statements;
+        while (current_token_type() != token_type::end_of_input) {
+            statements.push_back(parse_top_level(0));
         }
+        return finish(std::move(statements), {});
     }
 
-    std::shared_ptr<statement_node> parse() {
-        return nullptr;
+    // the next top-level statement, `base` is where the input of this
+    // parser starts in the whole source
+    statement_extent parse_top_level(std::size_t base) {
+        const std::size_t used = nodes_->bytes_used();
+        statement_node *statement = parse_block_item();
+        return {base + previous_offset_, statement, nodes_->bytes_used() - used};
     }
 
- private:
- public:
-    constexpr static std::size_t look_ahead_count = 2;
+    // a program of `statements`, made in this parser or in `arenas`
+    program finish(std::vector<statement_extent> statements, std::vector<std::shared_ptr<arena>> arenas) {
+        std::vector<statement_node *> nodes;
+        nodes.reserve(statements.size());
+        for (const statement_extent &statement : statements) {
+            nodes.push_back(statement.statement);
+        }
+        statement_node *root = make<block_node>(nodes_->copy(std::span<statement_node *const>{nodes}));
+        arenas.push_back(nodes_);
+        return program{std::move(arenas), root, std::move(statements), functions_ != nullptr};
+    }
+
+    // function bodies are only brace matched and parsed on the first call
+    // by default, parsing them eagerly finds every error when loading, token
+    // sources without the source text at hand always parse them eagerly
+    void set_lazy_function_bodies(bool lazy) noexcept {
+        lazy_functions_ = lazy;
+    }
+
+    // identical pure expressions share one node, e.g. the same index
+    // arithmetic or cast spelled out again and again, off by default, it
+    // only covers what is parsed after it is turned on
+    void set_hash_consing(bool on) {
+        if (!on) {
+            context_->hash_cons.reset();
+        } else if (!context_->hash_cons) {
+            context_->hash_cons.emplace();
+        }
+    }
+
+    // counts function bodies once they are parsed, deferred ones included
+    [[nodiscard]]
+    const parse_stats &stats() const noexcept {
+        return context_->stats;
+    }
 
-    lexer lexer_;
-    ring_buffer<detail::token, look_ahead_count> buffer_;
+    // how deep expressions and blocks may nest, default_max_depth unless
+    // set; parentheses, prefix operators and casts take no native stack,
+    // blocks, indexes, arguments and array sizes do, so those nest at most
+    // max_recursion_depth deep whatever the limit
+    void set_max_depth(std::size_t depth) noexcept {
+        context_->max_depth = depth;
+    }
 
-    std::shared_ptr<statement_node> parse_program() {
+    // the offset just past the last token matched
+    [[nodiscard]]
+    std::size_t previous_offset() const noexcept {
+        return previous_offset_;
+    }
+
+    // the expression at the current token, it shares the arena of the parser
+    compiled_expression compile_expression() {
+        expr_node *root = parse_expression();
+        return compiled_expression{std::vector{nodes_}, root};
+    }
+
+    constexpr static std::size_t default_max_depth = 100'000;
+    constexpr static std::size_t max_recursion_depth = 1'000;
+
+ private:
+ public:
+    // what is waiting on the operator stack of parse_binary()
+    enum class pending_kind : std::uint8_t {
+        binary, prefix, cast, parenthesis
+    };
+
+    struct pending {
+        pending_kind kind;
+        token_type op;
+    };
+
+    TokenSource tokens_;
+    // nodes parsed so far, a compiled program shares it
+    std::shared_ptr<arena> nodes_;
+    std::size_t previous_offset_ = 0;
+    bool lazy_functions_ = true;
+    // functions declared so far, in the arena, null until the first one
+    function_table *functions_ = nullptr;
+    // the function whose body is being parsed
+    function_node *function_ = nullptr;
+    // operators and operands of the binary expressions being parsed, an
+    // expression nested in brackets or arguments pushes above its parent
+    std::vector<pending> operators_;
+    std::vector<expr_node *> operands_;
+    // levels of nesting, and those of them parsed by recursion
+    std::size_t depth_ = 0;
+    std::size_t recursion_ = 0;
+    std::shared_ptr<parse_context> context_ = std::make_shared<parse_context>(default_max_depth);
+
+    statement_node *parse_program() {
         // TODO
         return parse_block_item_list();
     }
 
-    std::shared_ptr<statement_node> parse_statement() {
+    statement_node *parse_statement() {
         if (current_token_type() == token_type::left_brace) {
             return parse_compound();
         }
+        if (current_token_type() == token_type::keyword_return) {
+            return parse_return();
+        }
         // TODO
-        return nullptr;
+        return parse_expr_statement();
     }
 
-    std::shared_ptr<statement_node> parse_declaration() {
-        return nullptr;
+    statement_node *parse_declaration() {
+        if (current_token_type() == token_type::keyword_function) {
+            return parse_function();
+        }
+        const position_t position = tokens_.position_at(current_token().start);
+        throw_syntax_error("line {}, column {}: variables cannot be declared yet",
+                           position.lines_read + 1, position.chars_read_current_line + 1);
     }
 
-    std::shared_ptr<statement_node> parse_compound() {
+    // function name(type name, ...): type { ... }
+    statement_node *parse_function() {
+        if (function_ != nullptr) {
+            throw_syntax_error("function '{}' declares a function, only the top level can", function_->name());
+        }
+        match(token_type::keyword_function);
+        const std::string_view name = store(current_token().content);
+        match(token_type::identifier);
+
+        std::vector<variable_type> parameters;
+        match(token_type::left_parenthesis);
+        while (current_token_type() != token_type::right_parenthesis) {
+            if (!parameters.empty()) {
+                match(token_type::comma);
+            }
+            parameters.push_back(parse_type_name());
+            // there are no variables yet, so the body cannot use the name
+            match(token_type::identifier);
+        }
+        match(token_type::right_parenthesis);
+        match(token_type::colon);
+        const variable_type return_type = parse_type_name();
+
+        if (functions_ == nullptr) {
+            functions_ = nodes_->make<function_table>();
+        }
+        auto *function = make<function_node>(name, nodes_->copy(std::span<const variable_type>{parameters}),
+                                             return_type, functions_, functions_->size());
+        if (!functions_->try_emplace(name, function).second) {
+            throw_symbol_error("function '{}' is already defined", name);
+        }
+        if constexpr (requires { tokens_.skip_block(); }) {
+            if (lazy_functions_) {
+                if (current_token_type() != token_type::left_brace) {
+                    match(token_type::left_brace);
+                }
+                // otherwise lexed and parsed now, to report the error
+                if (std::optional<skipped_block> block = tokens_.skip_block()) {
+                    function->defer(store(block->text), block->position, &parse_deferred_body, context_);
+                    previous_offset_ = block->end;
+                    return function;
+                }
+            }
+        }
+        function_ = function;
+        function->define(parse_compound());
+        function_ = nullptr;
+        return function;
+    }
+
+    // the deferred body of `function`, it sees the functions declared up to
+    // `function`, positions count from where the body is in the source, and
+    // it is parsed with the context of the parser that deferred it
+    static statement_node *parse_deferred_body(function_node &function) {
+        lexer lex{span_input_adapter{function.body_text()}};
+        lex.resume(function.body_position().chars_read_total, line_index{function.body_position()});
+        parser<lexer_token_source<span_input_adapter>> psr{std::move(lex)};
+        psr.context_ = std::static_pointer_cast<parse_context>(function.body_context());
+        psr.functions_ = function.functions();
+        psr.function_ = &function;
+        statement_node *body = psr.parse_compound();
+        psr.match(token_type::end_of_input);
+        function.define(body, psr.nodes_);
+        return body;
+    }
+
+    statement_node *parse_return() {
+        if (function_ == nullptr) {
+            throw_syntax_error("return outside a function");
+        }
+        match(token_type::keyword_return);
+        expr_node *expr = parse_expression();
+        match(token_type::semicolon);
+        if (expr->eval_type() != function_->return_type()) {
+            throw_type_error("function '{}' returns {}, found {}",
+                             function_->name(), function_->return_type(), expr->eval_type());
+        }
+        return make<return_node>(expr);
+    }
+
+    variable_type parse_type_name() {
+        token_type type_name = current_token_type();
+        match("type name", {
+            token_type::keyword_int, token_type::keyword_float,
+            token_type::keyword_boolean, token_type::keyword_string,
+            token_type::keyword_char
+        });
+        return to_variable_type(type_name);
+    }
+
+    // a copy of `text` in the arena
+    std::string_view store(std::string_view text) {
+        std::span<char> copy = nodes_->copy(std::span<const char>{text});
+        return {copy.data(), copy.size()};
+    }
+
+    statement_node *parse_compound() {
+        nest(true);
         match(token_type::left_brace);
-        std::shared_ptr<statement_node> block_item_list = parse_block_item_list();
+        statement_node *block_item_list = parse_block_item_list();
         match(token_type::right_brace);
+        depth_--;
+        recursion_--;
         return block_item_list;
     }
 
-    std::shared_ptr<statement_node> parse_block_item_list() {
-        std::vector<std::shared_ptr<statement_node>> statements;
+    statement_node *parse_block_item_list() {
+        std::vector<statement_node *> statements;
         while (current_token_type() != token_type::right_brace && current_token_type() != token_type::end_of_input) {
             statements.push_back(parse_block_item());
         }
-        return std::make_shared<block_node>(std::move(statements));
+        return make<block_node>(nodes_->copy(std::span<statement_node *const>{statements}));
     }
 
-    std::shared_ptr<statement_node> parse_block_item() {
+    statement_node *parse_block_item() {
         if (is_basic_type(current_token_type()) ||
             current_token_type() == token_type::keyword_function) {
             return parse_declaration();
@@ -94,270 +323,240 @@ class parser {
         }
     }
 
-    std::shared_ptr<expr_stat_node> parse_expr_statement() {
+    expr_stat_node *parse_expr_statement() {
         if (current_token_type() == token_type::semicolon) {
             match(token_type::semicolon);
-            return std::make_shared<expr_stat_node>(nullptr);
+            return make<expr_stat_node>(nullptr);
         }
-        std::shared_ptr<expr_node> expr = parse_expression();
+        expr_node *expr = parse_expression();
         match(token_type::semicolon);
-        return std::make_shared<expr_stat_node>(std::move(expr));
+        return make<expr_stat_node>(expr);
     }
 
-    std::shared_ptr<expr_node> parse_expression() {
+    expr_node *parse_expression() {
         // TODO
         return parse_assignment();
     }
 
-    std::shared_ptr<expr_node> parse_assignment() {
+    expr_node *parse_assignment() {
         // TODO
         return parse_conditional();
     }
 
-    std::shared_ptr<expr_node> parse_conditional() {
+    expr_node *parse_conditional() {
         // TODO
-        return parse_logical_or();
-    }
-
-    std::shared_ptr<expr_node> parse_logical_or() {
-        std::shared_ptr<expr_node> lhs = parse_logical_and();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::logical_or) {
-            match(token_type::logical_or);
-            rhs = parse_logical_and();
-            op = std::make_shared<logical_or_node>(std::move(lhs), std::move(rhs));
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_logical_and() {
-        std::shared_ptr<expr_node> lhs = parse_bit_or();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::logical_and) {
-            match(token_type::logical_and);
-            rhs = parse_bit_or();
-            op = std::make_shared<logical_and_node>(std::move(lhs), std::move(rhs));
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_bit_or() {
-        std::shared_ptr<expr_node> lhs = parse_bit_xor();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::bit_or) {
-            match(token_type::bit_or);
-            rhs = parse_bit_xor();
-            op = std::make_shared<bit_or_node>(std::move(lhs), std::move(rhs));
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_bit_xor() {
-        std::shared_ptr<expr_node> lhs = parse_bit_and();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::bit_xor) {
-            match(token_type::bit_xor);
-            rhs = parse_bit_and();
-            op = std::make_shared<bit_xor_node>(std::move(lhs), std::move(rhs));
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_bit_and() {
-        std::shared_ptr<expr_node> lhs = parse_equality();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::bit_and) {
-            match(token_type::bit_and);
-            rhs = parse_equality();
-            op = std::make_shared<bit_and_node>(std::move(lhs), std::move(rhs));
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_equality() {
-        std::shared_ptr<expr_node> lhs = parse_relational();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::equal || current_token_type() == token_type::not_equal) {
-            if (current_token_type() == token_type::equal) {
-                match(token_type::equal);
-                rhs = parse_relational();
-                op = std::make_shared<equal_node>(std::move(lhs), std::move(rhs));
-            } else {
-                match(token_type::not_equal);
-                rhs = parse_relational();
-                op = std::make_shared<not_equal_node>(std::move(lhs), std::move(rhs));
-            }
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_relational() {
-        std::shared_ptr<expr_node> lhs = parse_shift();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::less || current_token_type() == token_type::less_equal ||
-               current_token_type() == token_type::greater || current_token_type() == token_type::greater_equal) {
-            if (current_token_type() == token_type::less) {
-                match(token_type::less);
-                rhs = parse_shift();
-                op = std::make_shared<less_node>(std::move(lhs), std::move(rhs));
-            } else if (current_token_type() == token_type::less_equal) {
-                match(token_type::less_equal);
-                rhs = parse_shift();
-                op = std::make_shared<less_equal_node>(std::move(lhs), std::move(rhs));
-            } else if (current_token_type() == token_type::greater) {
-                match(token_type::greater);
-                rhs = parse_shift();
-                op = std::make_shared<greater_node>(std::move(lhs), std::move(rhs));
-            } else {
-                match(token_type::greater_equal);
-                rhs = parse_shift();
-                op = std::make_shared<greater_equal_node>(std::move(lhs), std::move(rhs));
-            }
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_shift() {
-        std::shared_ptr<expr_node> lhs = parse_additive();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::shift_left || current_token_type() == token_type::shift_right) {
-            if (current_token_type() == token_type::shift_left) {
-                match(token_type::shift_left);
-                rhs = parse_additive();
-                op = std::make_shared<shift_left_node>(std::move(lhs), std::move(rhs));
-            } else  {
-                match(token_type::shift_right);
-                rhs = parse_additive();
-                op = std::make_shared<shift_right_node>(std::move(lhs), std::move(rhs));
+        return parse_binary();
+    }
+
+    // binary operators by precedence, all of them left associative, with
+    // the prefix operators, casts and parentheses of their operands
+    //
+    // pending operators go to a stack instead of the native one, so nesting
+    // costs no recursion, an operand gets its prefix operators and casts as
+    // soon as it is parsed, since they bind tighter than any binary operator
+    expr_node *parse_binary() {
+        const std::size_t operator_base = operators_.size();
+        const std::size_t operand_base = operands_.size();
+        const std::size_t depth = depth_;
+        nest(true);
+        std::size_t open = 0;
+        while (true) {
+            parse_prefixes(open);
+            operands_.push_back(current_token_type() == token_type::keyword_new ? parse_new() : parse_postfix());
+            while (true) {
+                reduce_prefixes(operator_base);
+                const token_type op = current_token_type();
+                const std::uint8_t precedence = binary_precedence[static_cast<std::size_t>(op)];
+                if (precedence != 0) {
+                    reduce_binary(operator_base, precedence);
+                    get_token();
+                    operators_.push_back({pending_kind::binary, op});
+                    break;
+                }
+                if (op != token_type::right_parenthesis || open == 0) {
+                    if (open != 0) {
+                        match(token_type::right_parenthesis);
+                    }
+                    reduce_binary(operator_base, 1);
+                    expr_node *expr = operands_.back();
+                    assert(operators_.size() == operator_base && operands_.size() == operand_base + 1);
+                    operands_.pop_back();
+                    depth_ = depth;
+                    recursion_--;
+                    return expr;
+                }
+                reduce_binary(operator_base, 1);
+                assert(operators_.back().kind == pending_kind::parenthesis);
+                operators_.pop_back();
+                open--;
+                depth_--;
+                match(token_type::right_parenthesis);
+                if (current_token_type() == token_type::left_bracket) {
+                    operands_.back() = parse_array_value(operands_.back());
+                }
             }
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_additive() {
-        std::shared_ptr<expr_node> lhs = parse_multiplicative();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::plus || current_token_type() == token_type::minus) {
-            if (current_token_type() == token_type::plus) {
-                match(token_type::plus);
-                rhs = parse_multiplicative();
-                op = std::make_shared<add_node>(std::move(lhs), std::move(rhs));
-            } else  {
-                match(token_type::minus);
-                rhs = parse_multiplicative();
-                op = std::make_shared<minus_node>(std::move(lhs), std::move(rhs));
+        }
+    }
+
+    // the prefix operators, casts and open parentheses before an operand
+    void parse_prefixes(std::size_t &open) {
+        while (true) {
+            const token_type type = current_token_type();
+            switch (type) {
+                case token_type::left_parenthesis:
+                    nest();
+                    if (is_basic_type(tokens_.peek_type(1))) {
+                        match(token_type::left_parenthesis);
+                        token_type type_name = current_token_type();
+                        match("type name", {
+                            token_type::keyword_int, token_type::keyword_float,
+                            token_type::keyword_boolean, token_type::keyword_string,
+                            token_type::keyword_char
+                        });
+                        match(token_type::right_parenthesis);
+                        operators_.push_back({pending_kind::cast, type_name});
+                    } else {
+                        match(token_type::left_parenthesis);
+                        operators_.push_back({pending_kind::parenthesis, type});
+                        open++;
+                    }
+                    break;
+                case token_type::plus:
+                    match(token_type::plus);
+                    break;
+                case token_type::minus:
+                case token_type::bit_not:
+                case token_type::logical_not:
+                    nest();
+                    match(type);
+                    operators_.push_back({pending_kind::prefix, type});
+                    break;
+                default:
+                    return;
             }
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_multiplicative() {
-        std::shared_ptr<expr_node> lhs = parse_cast();
-        std::shared_ptr<expr_node> rhs = nullptr;
-        std::shared_ptr<expr_node> op = nullptr;
-        while (current_token_type() == token_type::asterisk || current_token_type() == token_type::slash ||
-               current_token_type() == token_type::mod) {
-            if (current_token_type() == token_type::asterisk) {
-                match(token_type::asterisk);
-                rhs = parse_cast();
-                op = std::make_shared<multiply_node>(std::move(lhs), std::move(rhs));
-            } else if (current_token_type() == token_type::slash) {
-                match(token_type::slash);
-                rhs = parse_cast();
-                op = std::make_shared<divide_node>(std::move(lhs), std::move(rhs));
+        }
+    }
+
+    // applies the prefix operators and casts on top of the stack to the
+    // last operand
+    void reduce_prefixes(std::size_t operator_base) {
+        while (operators_.size() > operator_base) {
+            const pending op = operators_.back();
+            expr_node *&expr = operands_.back();
+            if (op.kind == pending_kind::cast) {
+                expr = make_expr<type_cast_node>(expr, to_variable_type(op.op));
+            } else if (op.kind == pending_kind::prefix) {
+                switch (op.op) {
+                    case token_type::minus:
+                        expr = make_expr<negative_node>(expr);
+                        break;
+                    case token_type::bit_not:
+                        expr = make_expr<bit_not_node>(expr);
+                        break;
+                    default:
+                        expr = make_expr<logical_not_node>(expr);
+                        break;
+                }
             } else {
-                match(token_type::mod);
-                rhs = parse_cast();
-                op = std::make_shared<modulus_node>(std::move(lhs), std::move(rhs));
-            }
-            lhs = op;
-            op = nullptr;
-        }
-        return lhs;
-    }
-
-    std::shared_ptr<expr_node> parse_cast() {
-        if (current_token_type() == token_type::left_parenthesis && is_basic_type(next_token(1).type)) {
-            match(token_type::left_parenthesis);
-            token_type type_name = current_token_type();
-
-            match("type name", {
-                token_type::keyword_int, token_type::keyword_float,
-                token_type::keyword_boolean, token_type::keyword_string,
-                token_type::keyword_char
-            });
-            match(token_type::right_parenthesis);
-
-            std::shared_ptr<expr_node> expr = parse_cast();
-
-            switch (type_name) {
-                case token_type::keyword_int:
-                    return std::make_shared<type_cast_node>(std::move(expr), variable_type::integer);
-                case token_type::keyword_float:
-                    return std::make_shared<type_cast_node>(std::move(expr), variable_type::floating);
-                case token_type::keyword_boolean:
-                    return std::make_shared<type_cast_node>(std::move(expr), variable_type::boolean);
-                case token_type::keyword_string:
-                    return std::make_shared<type_cast_node>(std::move(expr), variable_type::string);
-                case token_type::keyword_char:
-                    return std::make_shared<type_cast_node>(std::move(expr), variable_type::character);
-                default:
-                    std::unreachable();
+                return;
             }
-            std::unreachable();
+            operators_.pop_back();
+            depth_--;
         }
-        return parse_unary();
     }
 
-    std::shared_ptr<expr_node> parse_unary() {
-        switch (current_token_type()) {
+    // applies the binary operators on top of the stack binding at least as
+    // tightly as `min_precedence`, they stop at an open parenthesis
+    void reduce_binary(std::size_t operator_base, std::uint8_t min_precedence) {
+        while (operators_.size() > operator_base && operators_.back().kind == pending_kind::binary &&
+               binary_precedence[static_cast<std::size_t>(operators_.back().op)] >= min_precedence) {
+            const token_type op = operators_.back().op;
+            operators_.pop_back();
+            expr_node *rhs = operands_.back();
+            operands_.pop_back();
+            operands_.back() = make_binary(op, operands_.back(), rhs);
+        }
+    }
+
+    // one level of nesting deeper, `recursive` when parsing it takes native
+    // stack
+    void nest(bool recursive = false) {
+        const bool too_deep = ++depth_ > context_->max_depth;
+        if (too_deep || (recursive && ++recursion_ > max_recursion_depth)) {
+            const position_t position = tokens_.position();
+            throw_syntax_error(
+                "line {}, column {}: nested deeper than {} levels",
+                position.lines_read + 1, position.chars_read_current_line + 1,
+                too_deep ? context_->max_depth : max_recursion_depth
+            );
+        }
+    }
+
+    expr_node *make_binary(token_type op, expr_node *lhs, expr_node *rhs) {
+        switch (op) {
+            case token_type::logical_or:
+                return make_expr<logical_or_node>(lhs, rhs);
+            case token_type::logical_and:
+                return make_expr<logical_and_node>(lhs, rhs);
+            case token_type::bit_or:
+                return make_expr<bit_or_node>(lhs, rhs);
+            case token_type::bit_xor:
+                return make_expr<bit_xor_node>(lhs, rhs);
+            case token_type::bit_and:
+                return make_expr<bit_and_node>(lhs, rhs);
+            case token_type::equal:
+                return make_expr<equal_node>(lhs, rhs);
+            case token_type::not_equal:
+                return make_expr<not_equal_node>(lhs, rhs);
+            case token_type::less:
+                return make_expr<less_node>(lhs, rhs);
+            case token_type::less_equal:
+                return make_expr<less_equal_node>(lhs, rhs);
+            case token_type::greater:
+                return make_expr<greater_node>(lhs, rhs);
+            case token_type::greater_equal:
+                return make_expr<greater_equal_node>(lhs, rhs);
+            case token_type::shift_left:
+                return make_expr<shift_left_node>(lhs, rhs);
+            case token_type::shift_right:
+                return make_expr<shift_right_node>(lhs, rhs);
             case token_type::plus:
-                match(token_type::plus);
-                return parse_unary();
+                return make_expr<add_node>(lhs, rhs);
             case token_type::minus:
-                match(token_type::minus);
-                return std::make_shared<negative_node>(parse_unary());
-            case token_type::bit_not:
-                match(token_type::bit_not);
-                return std::make_shared<bit_not_node>(parse_unary());
-            case token_type::logical_not:
-                match(token_type::logical_not);
-                return std::make_shared<logical_not_node>(parse_unary());
-            case token_type::keyword_new:
-                return parse_new();
+                return make_expr<minus_node>(lhs, rhs);
+            case token_type::asterisk:
+                return make_expr<multiply_node>(lhs, rhs);
+            case token_type::slash:
+                return make_expr<divide_node>(lhs, rhs);
+            case token_type::mod:
+                return make_expr<modulus_node>(lhs, rhs);
             default:
-                return parse_postfix();
+                std::unreachable();
         }
     }
 
-    std::shared_ptr<expr_node> parse_new() {
+    // how tightly each binary operator binds, 0 for other tokens
+    constexpr static std::array<std::uint8_t, static_cast<std::size_t>(token_type::parse_error) + 1> binary_precedence = [] {
+        std::array<std::uint8_t, static_cast<std::size_t>(token_type::parse_error) + 1> table{};
+        auto set = [&](std::uint8_t precedence, std::initializer_list<token_type> operators) {
+            for (token_type op : operators) {
+                table[static_cast<std::size_t>(op)] = precedence;
+            }
+        };
+        set(1,  {token_type::logical_or});
+        set(2,  {token_type::logical_and});
+        set(3,  {token_type::bit_or});
+        set(4,  {token_type::bit_xor});
+        set(5,  {token_type::bit_and});
+        set(6,  {token_type::equal, token_type::not_equal});
+        set(7,  {token_type::less, token_type::less_equal, token_type::greater, token_type::greater_equal});
+        set(8,  {token_type::shift_left, token_type::shift_right});
+        set(9,  {token_type::plus, token_type::minus});
+        set(10, {token_type::asterisk, token_type::slash, token_type::mod});
+        return table;
+    }();
+
+    expr_node *parse_new() {
         match(token_type::keyword_new);
         token_type type_name = current_token_type();
         match("primitive types", {
@@ -367,20 +566,20 @@ class parser {
         });
         variable_type elem_type = to_variable_type(type_name);
 
-        std::vector<std::shared_ptr<expr_node>> size_per_dim;
+        std::vector<expr_node *> size_per_dim;
         while (current_token_type() == token_type::left_bracket) {
             match(token_type::left_bracket);
-            std::shared_ptr<expr_node> size_node = parse_expression();
+            expr_node *size_node = parse_expression();
             if (size_node->eval_type() != variable_type::integer) {
                 throw_type_error("array size must be integer");
             }
-            size_per_dim.push_back(std::move(size_node));
+            size_per_dim.push_back(size_node);
             match(token_type::right_bracket);
         }
-        return std::make_shared<array_node>(elem_type, std::move(size_per_dim));
+        return make_expr<array_node>(elem_type, nodes_->copy(std::span<expr_node *const>{size_per_dim}));
     }
 
-    std::shared_ptr<expr_node> parse_postfix() {
+    expr_node *parse_postfix() {
         // TODO
         // switch (current_token_type()) {
         //     case token_type::left_bracket:
@@ -388,30 +587,29 @@ class parser {
         //     default:
         //         return parse_primary();
         // }
-        std::shared_ptr<expr_node> primary = parse_primary();
+        expr_node *primary = parse_primary();
         switch (current_token_type()) {
             case token_type::left_bracket:
             // case token_type::left_paren
-                return parse_array_value(std::move(primary));
+                return parse_array_value(primary);
             default:
                 return primary;
         }
     }
 
-    std::shared_ptr<expr_node> parse_array_value(std::shared_ptr<expr_node> array_node)  {
+    expr_node *parse_array_value(expr_node *array_node)  {
         // TODO
-        std::shared_ptr<expr_node> node{std::move(array_node)};
+        expr_node *node = array_node;
         while (current_token_type() == token_type::left_bracket /* || '(' || '.' */) {
             match(token_type::left_bracket);
-            std::shared_ptr<expr_node> index_node = parse_expression();
+            expr_node *index_node = parse_expression();
             match(token_type::right_bracket);
-            std::shared_ptr<expr_node> next = node;
-            node = std::make_shared<array_value_node>(std::move(next), std::move(index_node));
+            node = make_expr<array_value_node>(node, index_node);
         }
         return node;
     }
 
-    std::shared_ptr<expr_node> parse_primary() {
+    expr_node *parse_primary() {
         switch (current_token_type()) {
             case token_type::literal_int:
                 return make_node_and_match<int32_t>(token_type::literal_int);
@@ -425,20 +623,166 @@ class parser {
                 return make_node_and_match<std::string>(token_type::literal_string);
             case token_type::literal_char:
                 return make_node_and_match<char>(token_type::literal_char);
-            case token_type::left_parenthesis: {
-                match(token_type::left_parenthesis);
-                std::shared_ptr<expr_node> expr = parse_expression();
-                match(token_type::right_parenthesis);
-                return expr;
-            }
+            case token_type::literal_interpolated:
+                return parse_interpolation();
+            case token_type::left_brace:
+                return parse_array_literal();
             case token_type::identifier:
                 // return parse_variable_or_function_call();
+                if (tokens_.peek_type(1) == token_type::left_parenthesis) {
+                    return parse_function_call();
+                }
+                [[fallthrough]];
             default:
                 throw_syntax_error("not supported");
         }
     }
 
-    std::shared_ptr<expr_node> parse_variable_or_function_call() {
+    // $"text {expression} text", split here once, `{{` and `}}` stand for
+    // braces in the text, an expression is parsed by a parser of its own
+    // that puts its nodes in this arena
+    //
+    // a quote ends the literal wherever it is, so a string in a hole is
+    // written with escaped quotes, $"name={\"a\" + \"b\"}"; the content of
+    // the token is the text as written, so the column of each character is
+    // that of the first one plus its index
+    expr_node *parse_interpolation() {
+        const std::string_view content = current_token().content;
+        // where the text starts, just past `$"`
+        const position_t start = tokens_.position_at(current_token().start + 2);
+        const auto column = [&start](std::size_t index) {
+            return start.chars_read_current_line + index + 1;
+        };
+        match(token_type::literal_interpolated);
+
+        std::vector<std::string_view> texts;
+        std::vector<expr_node *> holes;
+        std::string text;
+        for (std::size_t i = 0; i < content.size(); i++) {
+            const char c = content[i];
+            if (c == '\\') {
+                // the lexer has checked the escape
+                text.push_back(*escape_value(content[++i]));
+            } else if ((c == '{' || c == '}') && i + 1 < content.size() && content[i + 1] == c) {
+                text.push_back(c);
+                i++;
+            } else if (c == '}') {
+                throw_syntax_error("line {}, column {}: single '}}' in interpolated string, write '}}}}'",
+                                   start.lines_read + 1, column(i));
+            } else if (c == '{') {
+                const std::size_t end = hole_end(content, i + 1);
+                if (end == std::string_view::npos) {
+                    throw_syntax_error("line {}, column {}: '{{' without '}}' in interpolated string, "
+                                       "a string in it is written with \\\"",
+                                       start.lines_read + 1, column(i));
+                }
+                const std::string_view hole = content.substr(i + 1, end - i - 1);
+                if (hole.find_first_not_of(" \t\r\f\v") == std::string_view::npos) {
+                    throw_syntax_error("line {}, column {}: empty '{{}}' in interpolated string, write '{{{{}}}}' for braces",
+                                       start.lines_read + 1, column(i));
+                }
+                texts.push_back(store(text));
+                text.clear();
+                holes.push_back(parse_hole(hole, start, i + 1));
+                i = end;
+            } else {
+                text.push_back(c);
+            }
+        }
+        if (holes.empty()) {
+            return make_expr<string_node>(std::move(text));
+        }
+        texts.push_back(store(text));
+        return make<interpolation_node>(nodes_->copy(std::span<const std::string_view>{texts}),
+                                        nodes_->copy(std::span<expr_node *const>{holes}));
+    }
+
+    // the closing brace of a hole starting at `from` in the text as written,
+    // skipping the braces of array literals and of what is quoted, npos if
+    // there is none
+    static std::size_t hole_end(std::string_view content, std::size_t from) {
+        std::size_t depth = 0;
+        for (std::size_t i = from; i < content.size(); i++) {
+            switch (content[i]) {
+                case '\\':
+                    if (i + 1 < content.size() && content[i + 1] == '"') {
+                        i = string_end(content, i + 2);
+                    } else {
+                        i++;
+                    }
+                    break;
+                case '\'':
+                    i = std::min(content.find('\'', i + 1), content.size());
+                    break;
+                case '{':
+                    depth++;
+                    break;
+                case '}':
+                    if (depth-- == 0) {
+                        return i;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // the quote of the \" closing a string in a hole whose text starts at
+    // `from`, an escape of the string itself is written \\ and then the
+    // character it escapes, e.g. \\n or \\\"
+    static std::size_t string_end(std::string_view content, std::size_t from) {
+        for (std::size_t i = from; i + 1 < content.size(); i++) {
+            if (content[i] != '\\') {
+                continue;
+            }
+            if (content[i + 1] == '"') {
+                return i + 1;
+            }
+            // past \\ and the character it escapes, itself written \x if it
+            // is a quote or a backslash
+            i += i + 2 < content.size() && content[i + 2] == '\\' ? 3 : 2;
+        }
+        return content.size();
+    }
+
+    // the expression of a hole `offset` characters into the text, lexed
+    // once its escapes are decoded, so past an escape in the hole a column
+    // is one less per escape before it
+    expr_node *parse_hole(std::string_view text, position_t start, std::size_t offset) {
+        start.chars_read_total += offset;
+        start.chars_read_current_line += offset;
+        std::string source;
+        for (std::size_t i = 0; i < text.size(); i++) {
+            source.push_back(text[i] == '\\' ? *escape_value(text[++i]) : text[i]);
+        }
+        lexer lex{span_input_adapter{std::string_view{source}}};
+        lex.resume(start.chars_read_total, line_index{start});
+        parser<lexer_token_source<span_input_adapter>> psr{std::move(lex), nodes_};
+        psr.functions_ = functions_;
+        psr.function_ = function_;
+        psr.context_ = context_;
+        expr_node *hole = psr.parse_expression();
+        psr.match(token_type::end_of_input);
+        return hole;
+    }
+
+    // {a, b, ...}, at the start of a statement a brace opens a block instead
+    expr_node *parse_array_literal() {
+        std::vector<expr_node *> elements;
+        match(token_type::left_brace);
+        while (current_token_type() != token_type::right_brace) {
+            if (!elements.empty()) {
+                match(token_type::comma);
+            }
+            elements.push_back(parse_expression());
+        }
+        match(token_type::right_brace);
+        return make_expr<array_literal_node>(nodes_->copy(std::span<expr_node *const>{elements}));
+    }
+
+    expr_node *parse_variable_or_function_call() {
         match(token_type::identifier);
         if (current_token_type() == token_type::left_parenthesis) {
             return parse_function_call();
@@ -446,80 +790,132 @@ class parser {
         return parse_variable();
     }
 
-    std::shared_ptr<expr_node> parse_variable() {
+    expr_node *parse_variable() {
         // TODO
         std::println("parse variable");
         return nullptr;
     }
 
-    std::shared_ptr<expr_node> parse_function_call() {
-        // TODO
-        std::println(("parse function call"));
-        return nullptr;
+    expr_node *parse_function_call() {
+        function_node *function = find_function(current_token().content);
+        match(token_type::identifier);
+
+        std::vector<expr_node *> arguments;
+        match(token_type::left_parenthesis);
+        while (current_token_type() != token_type::right_parenthesis) {
+            if (!arguments.empty()) {
+                match(token_type::comma);
+            }
+            arguments.push_back(parse_expression());
+        }
+        match(token_type::right_parenthesis);
+
+        const std::span<const variable_type> parameters = function->parameters();
+        if (arguments.size() != parameters.size()) {
+            throw_type_error("function '{}' takes {} arguments, found {}",
+                             function->name(), parameters.size(), arguments.size());
+        }
+        for (std::size_t i = 0; i < arguments.size(); i++) {
+            if (arguments[i]->eval_type() != parameters[i]) {
+                throw_type_error("argument {} of function '{}' must be {}, found {}",
+                                 i + 1, function->name(), parameters[i], arguments[i]->eval_type());
+            }
+        }
+        return make<function_call_node>(function, nodes_->copy(std::span<expr_node *const>{arguments}));
+    }
+
+    // a function declared before the current one, or the current one
+    function_node *find_function(std::string_view name) const {
+        if (functions_ != nullptr) {
+            auto iter = functions_->find(name);
+            if (iter != functions_->end() && (function_ == nullptr || iter->second->index() <= function_->index())) {
+                return iter->second;
+            }
+        }
+        throw_symbol_error("undefined function '{}'", name);
+    }
+
+    template <typename Node, typename... Args>
+    Node *make(Args &&...args) {
+        return nodes_->make<Node>(std::forward<Args>(args)...);
+    }
+
+    // an expression node, or the one made before for the same expression
+    // when hash consing
+    template <typename Node, typename... Args>
+    expr_node *make_expr(Args &&...args) {
+        context_->stats.expressions++;
+        if (!context_->hash_cons) {
+            return make<Node>(std::forward<Args>(args)...);
+        }
+        // looked up with a node on the stack, so one found takes no space
+        const Node probe(args...);
+        if (expr_node *node = context_->hash_cons->find(probe)) {
+            context_->stats.shared++;
+            return node;
+        }
+        Node *node = make<Node>(std::forward<Args>(args)...);
+        context_->hash_cons->insert(node);
+        return node;
     }
 
     template <typename T>
-    std::shared_ptr<expr_node> make_node_and_match(token_type type) {
+    expr_node *make_node_and_match(token_type type) {
         static_type_check<T>();
         static_assert(!std::is_same_v<T, array>);
-        std::shared_ptr<expr_node> node = make_node<T>(current_token());
+        expr_node *node = make_node<T>(current_token());
         match(type);
         return node;
     }
 
     template <typename T>
     [[nodiscard]]
-    std::shared_ptr<expr_node> make_node(const token &token) const {
+    expr_node *make_node(const token &token) {
         static_type_check<T>();
         static_assert(!std::is_same_v<T, array>);
 
         if constexpr (std::is_same_v<T, int32_t>) {
-            int32_t value = std::stoi(token.content);
-            return std::make_shared<int_node>(value);
+            return make_expr<int_node>(std::get<int32_t>(token.number));
 
         } else if constexpr (std::is_same_v<T, double>) {
-            double value = std::stod(token.content);
-            return std::make_shared<float_node>(value);
+            return make_expr<float_node>(std::get<double>(token.number));
 
         } else if constexpr (std::is_same_v<T, bool>) {
-            return std::make_shared<boolean_node>(token.type == token_type::literal_true);
+            return make_expr<boolean_node>(token.type == token_type::literal_true);
 
         } else if constexpr (std::is_same_v<T, std::string>) {
-            const std::string str = token.content;
-            return std::make_shared<string_node>(str.substr(1, str.size() - 2));
+            return make_expr<string_node>(std::string{token.content});
 
         } else {    // char
-            return std::make_shared<char_node>(token.content.at(0));
+            return make_expr<char_node>(token.content.at(0));
         }
     }
 
     [[nodiscard]]
-    const token &current_token() const noexcept {
-        return buffer_.get_next(0);
+    decltype(auto) current_token() const {
+        return tokens_.peek(0);
     }
 
     [[nodiscard]]
     token_type current_token_type() const noexcept {
-        return buffer_.get_next(0).type;
+        return tokens_.peek_type(0);
     }
 
     void get_token() {
-        // auto t = lexer_.next_token();
-        // std::println("{}", t);
-        buffer_.put(lexer_.next_token());
-        // buffer_.put(t);
+        previous_offset_ = current_token().offset;
+        tokens_.advance();
     }
 
     [[nodiscard]]
-    const token &next_token(std::size_t distance) const noexcept {
-        return buffer_.get_next(distance);
+    decltype(auto) next_token(std::size_t distance) const {
+        return tokens_.peek(distance);
     }
 
     void match(token_type expect) {
         if (current_token_type() == expect) {
             get_token();
         } else {
-            const auto &position = lexer_.position();
+            const position_t position = tokens_.position();
             throw_syntax_error(
                 "line {}, column {}: expect '{}', found '{}'",
                 position.lines_read + 1, position.chars_read_current_line + 1,
@@ -535,7 +931,7 @@ class parser {
                 return;
             }
         }
-        const auto &position = lexer_.position();
+        const position_t position = tokens_.position();
         throw_syntax_error(
             "line {}, column {}: expect {}, found '{}'",
             position.lines_read + 1, position.chars_read_current_line + 1,
@@ -544,6 +940,15 @@ class parser {
     }
 };
 
+template <typename InputAdapter, typename... Nodes>
+parser(lexer<InputAdapter> &&, Nodes...) -> parser<lexer_token_source<InputAdapter>>;
+
+template <typename InputAdapter, typename... Nodes>
+parser(token_stream<InputAdapter> &&, Nodes...) -> parser<stream_token_source<InputAdapter>>;
+
+template <typename InputAdapter, typename... Nodes>
+parser(pipelined<InputAdapter> &&, Nodes...) -> parser<pipelined_token_source<InputAdapter>>;
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef NEROLL_SCRIPT_PROGRAM_H
+#define NEROLL_SCRIPT_PROGRAM_H
+
+#include <cstddef>  // size_t
+#include <memory>   // shared_ptr, make_shared
+#include <span>     // span
+#include <utility>  // move
+#include <vector>   // vector
+
+#include "detail/arena.h"
+#include "detail/ast.h"
+
+namespace neroll::script {
+
+// a parsed script, owns the arenas its nodes were made in, so destroying
+// it frees the whole tree at once, an arena is shared with the programs
+// reparsed from this one, which reuse some of its nodes
+template <typename Node>
+class compiled {
+ public:
+    compiled(detail::arena nodes, Node *root)
+        : arenas_{std::make_shared<detail::arena>(std::move(nodes))}, root_(root) {}
+
+    compiled(std::vector<std::shared_ptr<detail::arena>> arenas, Node *root) noexcept
+        : arenas_(std::move(arenas)), root_(root) {}
+
+    [[nodiscard]]
+    Node *root() const noexcept {
+        return root_;
+    }
+
+    Node *operator->() const noexcept {
+        return root_;
+    }
+
+    // memory taken by the nodes, shared arenas included
+    [[nodiscard]]
+    std::size_t bytes() const noexcept {
+        std::size_t total = 0;
+        for (const auto &nodes : arenas_) {
+            total += nodes->bytes_used();
+        }
+        return total;
+    }
+
+    [[nodiscard]]
+    const std::vector<std::shared_ptr<detail::arena>> &arenas() const noexcept {
+        return arenas_;
+    }
+
+ private:
+    std::vector<std::shared_ptr<detail::arena>> arenas_;
+    Node *root_;
+};
+
+// a top-level statement, which covers the source from the end of the one
+// before it to the end of its last token
+struct statement_extent {
+    std::size_t end;
+    detail::statement_node *statement;
+    // arena bytes its nodes take
+    std::size_t bytes;
+};
+
+// the root is a block of the top-level statements
+class program : public compiled<detail::statement_node> {
+ public:
+    program(std::vector<std::shared_ptr<detail::arena>> arenas, detail::statement_node *root,
+            std::vector<statement_extent> statements, bool declares_functions = false) noexcept
+        : compiled(std::move(arenas), root), statements_(std::move(statements)),
+          declares_functions_(declares_functions) {
+        for (const statement_extent &statement : statements_) {
+            live_bytes_ += statement.bytes;
+        }
+    }
+
+    [[nodiscard]]
+    std::span<const statement_extent> statements() const noexcept {
+        return statements_;
+    }
+
+    // memory taken by the nodes still reachable from the root
+    [[nodiscard]]
+    std::size_t live_bytes() const noexcept {
+        return live_bytes_;
+    }
+
+    // calls are bound to the functions declared when they were parsed
+    [[nodiscard]]
+    bool declares_functions() const noexcept {
+        return declares_functions_;
+    }
+
+ private:
+    std::vector<statement_extent> statements_;
+    std::size_t live_bytes_ = 0;
+    bool declares_functions_;
+};
+
+using compiled_expression = compiled<detail::expr_node>;
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef NEROLL_SCRIPT_REPARSE_H
+#define NEROLL_SCRIPT_REPARSE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "detail/arena.h"
+#include "detail/input_adapter.h"
+#include "detail/lexer.h"
+#include "parser.h"
+#include "program.h"
+
+namespace neroll::script {
+
+// `removed` characters at `offset` replaced by `inserted` ones
+struct text_edit {
+    std::size_t offset;
+    std::size_t removed;
+    std::size_t inserted;
+};
+
+// the program of `source`, which is the source of `previous` after `edit`,
+// only the top-level statements the edit touches are lexed and parsed
+// again, the others are shared with `previous`, a statement is reparsed as
+// a whole, nested blocks included
+//
+// the lexer is in the same state after every token, so once a reparsed
+// statement ends where an old one ended past the edit, the rest of the
+// source parses as it did before and its statements are reused
+inline program reparse(const program &previous, std::string_view source, text_edit edit) {
+    const std::span<const statement_extent> old = previous.statements();
+    // old nodes no longer reachable are kept until the next full parse,
+    // which comes once they take more memory than the live ones
+    std::size_t reserved = 0;
+    for (const auto &nodes : previous.arenas()) {
+        reserved += nodes->bytes_reserved();
+    }
+    // a reused call would still be bound to a function the edit may have
+    // changed, so scripts with functions are parsed again as a whole
+    if (reserved > 2 * previous.live_bytes() + arena::chunk_size || previous.declares_functions()) {
+        return parser{lexer{span_input_adapter{source}}}.parse();
+    }
+    assert(edit.offset + edit.inserted <= source.size());
+    const std::size_t edit_end = edit.offset + edit.removed;
+
+    // the first statement the edit touches, counting one that ends where
+    // the edit starts, and the one before it, whose last token may have
+    // been lexed looking at the first edited character
+    auto touched = std::ranges::lower_bound(old, edit.offset, {}, &statement_extent::end);
+    std::size_t first = static_cast<std::size_t>(touched - old.begin());
+    first = first > 0 ? first - 1 : 0;
+    const std::size_t begin = first > 0 ? old[first - 1].end : 0;
+
+    // where the old statement ending at `end` in the new source ended in
+    // the old one, when that is past the edit
+    const auto resume = [&](std::size_t end) -> const statement_extent * {
+        if (end + edit.removed < edit.inserted || end + edit.removed - edit.inserted < edit_end) {
+            return nullptr;
+        }
+        const std::size_t old_end = end + edit.removed - edit.inserted;
+        auto iter = std::ranges::lower_bound(old, old_end, {}, &statement_extent::end);
+        return iter != old.end() && iter->end == old_end ? &*iter : nullptr;
+    };
+
+    std::vector<statement_extent> statements(old.begin(), old.begin() + static_cast<std::ptrdiff_t>(first));
+    try {
+        parser psr{lexer{span_input_adapter{source.substr(begin)}}};
+        while (psr.current_token_type() != token_type::end_of_input) {
+            statements.push_back(psr.parse_top_level(begin));
+            if (const statement_extent *last = resume(statements.back().end)) {
+                for (const statement_extent *rest = last + 1; rest != old.data() + old.size(); rest++) {
+                    statements.push_back({rest->end + edit.inserted - edit.removed, rest->statement, rest->bytes});
+                }
+                break;
+            }
+        }
+        return psr.finish(std::move(statements), previous.arenas());
+    } catch (...) {
+        // report the error where a full parse reports it
+        return parser{lexer{span_input_adapter{source}}}.parse();
+    }
+}
+
+}
+
+#endif
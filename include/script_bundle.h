@@ -0,0 +1,261 @@
+#ifndef NEROLL_SCRIPT_SCRIPT_BUNDLE_H
+#define NEROLL_SCRIPT_SCRIPT_BUNDLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "detail/arena.h"
+#include "detail/flat_ast.h"
+#include "detail/input_adapter.h"
+#include "detail/lexer.h"
+#include "detail/output_file.h"
+#include "parser.h"
+#include "script_cache.h"
+#include "script_loader.h"
+
+namespace neroll::script {
+
+// the layout version of bundle files, script_bundle refuses any other
+constexpr std::uint32_t bundle_version = 1;
+
+// a script to pack, by the name it is looked up by
+struct bundle_script {
+    std::string name;
+    std::string source;
+};
+
+// many scripts in one file, mapped once, with an index of entries sorted
+// by name, so a script is found by binary search and its source is a view
+// of the mapping
+//
+// header, entries, names, then the sources and compiled images, each
+// aligned to 8 bytes, all offsets count from the start of the file
+class script_bundle {
+ public:
+    explicit script_bundle(const std::filesystem::path &file)
+        : file_(std::make_shared<const detail::mmap_input_adapter>(file)) {
+        const char *data = file_->data();
+        const std::size_t size = file_->size();
+        if (size < sizeof(bundle_header)) {
+            throw_invalid(file);
+        }
+        bundle_header header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != magic || header.version != bundle_version || header.end != size ||
+            header.entry_count > (size - sizeof(header)) / sizeof(bundle_entry)) {
+            throw_invalid(file);
+        }
+        // mappings are page aligned and the entries follow the header
+        entries_ = {reinterpret_cast<const bundle_entry *>(data + sizeof(header)), header.entry_count};
+        for (std::size_t i = 0; i < entries_.size(); i++) {
+            const bundle_entry &entry = entries_[i];
+            if (!within(entry.name_offset, entry.name_size, size) ||
+                !within(entry.source_offset, entry.source_size, size) ||
+                !within(entry.image_offset, entry.image_size, size) || entry.image_offset % 8 != 0 ||
+                (i > 0 && !(name(i - 1) < name(i)))) {
+                throw_invalid(file);
+            }
+        }
+    }
+
+    // scripts that are a single expression get a compiled image when
+    // `images` is set, throws when names repeat or the file cannot be
+    // written
+    static void pack(const std::filesystem::path &file, std::vector<bundle_script> scripts, bool images) {
+        std::ranges::sort(scripts, {}, &bundle_script::name);
+        const auto repeated = std::ranges::adjacent_find(scripts, {}, &bundle_script::name);
+        if (repeated != scripts.end()) {
+            throw std::invalid_argument(std::format("script '{}' is packed twice", repeated->name));
+        }
+
+        std::vector<bundle_entry> entries(scripts.size());
+        std::string names;
+        for (std::size_t i = 0; i < scripts.size(); i++) {
+            entries[i].name_offset = names.size();
+            entries[i].name_size = scripts[i].name.size();
+            names += scripts[i].name;
+        }
+        std::uint64_t offset = sizeof(bundle_header) + entries.size() * sizeof(bundle_entry);
+        for (bundle_entry &entry : entries) {
+            entry.name_offset += offset;
+        }
+        offset = aligned(offset + names.size());
+
+        std::vector<std::string> compiled(scripts.size());
+        for (std::size_t i = 0; i < scripts.size(); i++) {
+            entries[i].source_offset = offset;
+            entries[i].source_size = scripts[i].source.size();
+            offset = aligned(offset + scripts[i].source.size());
+            if (images) {
+                compiled[i] = compile(scripts[i].source);
+                entries[i].image_offset = offset;
+                entries[i].image_size = compiled[i].size();
+                offset = aligned(offset + compiled[i].size());
+            }
+        }
+        const bundle_header header{magic, bundle_version, entries.size(), offset};
+
+        const std::error_code error = detail::write_atomically(file, [&](std::ostream &out) {
+            std::uint64_t written = 0;
+            const auto put = [&](const void *data, std::size_t size) {
+                out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                written += size;
+            };
+            const auto pad = [&] {
+                constexpr char padding[8]{};
+                put(padding, aligned(written) - written);
+            };
+            put(&header, sizeof(header));
+            put(entries.data(), entries.size() * sizeof(bundle_entry));
+            put(names.data(), names.size());
+            pad();
+            for (std::size_t i = 0; i < scripts.size(); i++) {
+                put(scripts[i].source.data(), scripts[i].source.size());
+                pad();
+                put(compiled[i].data(), compiled[i].size());
+                pad();
+            }
+        });
+        if (error) {
+            throw std::system_error(error, "cannot write " + file.string());
+        }
+    }
+
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return entries_.size();
+    }
+
+    // the name of the `index`-th script, in sorted order
+    [[nodiscard]]
+    std::string_view name(std::size_t index) const noexcept {
+        return view(entries_[index].name_offset, entries_[index].name_size);
+    }
+
+    // a view of the mapping, valid for as long as the bundle lives
+    [[nodiscard]]
+    std::optional<std::string_view> source(std::string_view name) const noexcept {
+        const bundle_entry *entry = find(name);
+        if (entry == nullptr) {
+            return std::nullopt;
+        }
+        return view(entry->source_offset, entry->source_size);
+    }
+
+    // the compiled image of a script, it keeps the mapping alive, null when
+    // the script has none or it does not match the source
+    [[nodiscard]]
+    std::optional<detail::flat_expression> image(std::string_view name) const {
+        const bundle_entry *entry = find(name);
+        if (entry == nullptr || entry->image_size == 0) {
+            return std::nullopt;
+        }
+        const std::string_view source = view(entry->source_offset, entry->source_size);
+        const std::string_view image = view(entry->image_offset, entry->image_size);
+        return script_cache::read(script_cache::key(source), image, file_);
+    }
+
+ private:
+    constexpr static std::uint32_t magic = 0x4243534e;   // "NSCB", checked like the magic of an image
+
+    struct bundle_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t entry_count;
+        std::uint64_t end;
+    };
+
+    // an image size of 0 is no image
+    struct bundle_entry {
+        std::uint64_t name_offset;
+        std::uint64_t name_size;
+        std::uint64_t source_offset;
+        std::uint64_t source_size;
+        std::uint64_t image_offset;
+        std::uint64_t image_size;
+    };
+
+    std::shared_ptr<const detail::mmap_input_adapter> file_;
+    std::span<const bundle_entry> entries_;
+
+    [[nodiscard]]
+    static std::uint64_t aligned(std::uint64_t offset) noexcept {
+        return (offset + 7) / 8 * 8;
+    }
+
+    [[nodiscard]]
+    static bool within(std::uint64_t offset, std::uint64_t size, std::size_t end) noexcept {
+        return offset <= end && size <= end - offset;
+    }
+
+    [[noreturn]]
+    static void throw_invalid(const std::filesystem::path &file) {
+        throw std::runtime_error(std::format("{} is not a script bundle of version {}", file.string(), bundle_version));
+    }
+
+    [[nodiscard]]
+    std::string_view view(std::uint64_t offset, std::uint64_t size) const noexcept {
+        return {file_->data() + offset, static_cast<std::size_t>(size)};
+    }
+
+    [[nodiscard]]
+    const bundle_entry *find(std::string_view name) const noexcept {
+        auto iter = std::ranges::lower_bound(entries_, name, {}, [this](const bundle_entry &entry) {
+            return view(entry.name_offset, entry.name_size);
+        });
+        if (iter == entries_.end() || view(iter->name_offset, iter->name_size) != name) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    // the image of a source that is one expression, empty for any other
+    static std::string compile(std::string_view source) {
+        try {
+            parser psr{detail::lexer{detail::span_input_adapter{source}}};
+            compiled_expression compiled = psr.compile_expression();
+            if (psr.current_token_type() != detail::token_type::end_of_input) {
+                return {};
+            }
+            std::ostringstream image;
+            script_cache::write(image, script_cache::key(source), detail::flat_expression{*compiled.root()});
+            return std::move(image).str();
+        } catch (const std::exception &) {
+            return {};
+        }
+    }
+};
+
+// parses the script `name` of `bundle` straight from the mapping, its
+// nodes go to `nodes`
+inline loaded_script load_script(const script_bundle &bundle, std::string_view name,
+                                 std::shared_ptr<detail::arena> nodes = std::make_shared<detail::arena>()) {
+    const std::optional<std::string_view> source = bundle.source(name);
+    if (!source) {
+        return {std::string{name}, std::nullopt, std::format("no script '{}' in the bundle", name)};
+    }
+    try {
+        return {std::string{name}, parser{detail::lexer{detail::span_input_adapter{*source}}, std::move(nodes)}.parse(), {}};
+    } catch (const std::exception &e) {
+        return {std::string{name}, std::nullopt, e.what()};
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef NEROLL_SCRIPT_SCRIPT_CACHE_H
+#define NEROLL_SCRIPT_SCRIPT_CACHE_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "detail/array.h"
+#include "detail/ast.h"
+#include "detail/flat_ast.h"
+#include "detail/input_adapter.h"
+#include "detail/output_file.h"
+#include "parser.h"
+#include "variable.h"
+
+namespace neroll::script {
+
+// bump whenever node kinds, their operands or the image layout change,
+// images of other versions are never read
+constexpr std::uint32_t compiled_image_version = 1;
+
+// what a compiled image is looked up by
+struct script_key {
+    std::uint64_t hash;
+    std::uint64_t size;
+};
+
+// a directory of compiled images, one per distinct source, each written
+// after a successful parse and mapped again instead of parsing on later
+// runs, an image that is missing, stale or damaged is a miss
+class script_cache {
+ public:
+    explicit script_cache(std::filesystem::path directory)
+        : directory_(std::move(directory)) {}
+
+    // FNV-1a of the source and its size, which is all an image is matched
+    // by, so a source that collides with a cached one silently runs the
+    // program of the other; the cache is for sources that are trusted
+    [[nodiscard]]
+    static script_key key(std::string_view source) noexcept {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (char c : source) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+        }
+        return {hash, source.size()};
+    }
+
+    [[nodiscard]]
+    std::filesystem::path image_path(script_key key) const {
+        return directory_ / std::format("{:016x}.v{}.nsc", key.hash, compiled_image_version);
+    }
+
+    // the layout points into the mapped image, which stays mapped for as
+    // long as the expression lives
+    [[nodiscard]]
+    std::optional<detail::flat_expression> load(script_key key) const {
+        std::shared_ptr<const detail::mmap_input_adapter> image;
+        try {
+            image = std::make_shared<const detail::mmap_input_adapter>(image_path(key));
+        } catch (const std::system_error &) {
+            return std::nullopt;
+        }
+        const std::span<const char> bytes{image->data(), image->size()};
+        return read(key, bytes, std::move(image));
+    }
+
+    // returns false when the image could not be written, a reader never
+    // maps one half written
+    bool store(script_key key, const detail::flat_expression &expression) const {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (error) {
+            return false;
+        }
+        return !detail::write_atomically(image_path(key), [&](std::ostream &out) {
+            write(out, key, expression);
+        });
+    }
+
+    // the image of `expression`, compiled from the source of `key`
+    static void write(std::ostream &out, script_key key, const detail::flat_expression &expression) {
+        std::vector<image_constant> constants;
+        std::string text;
+        for (const detail::value_t &value : expression.constants()) {
+            image_constant constant{static_cast<std::uint32_t>(value.index()), 0, 0};
+            switch (static_cast<variable_type>(value.index())) {
+                case variable_type::integer:
+                    constant.bits = static_cast<std::uint32_t>(std::get<int32_t>(value));
+                    break;
+                case variable_type::floating:
+                    constant.bits = std::bit_cast<std::uint64_t>(std::get<double>(value));
+                    break;
+                case variable_type::boolean:
+                    constant.bits = std::get<bool>(value);
+                    break;
+                case variable_type::character:
+                    constant.bits = static_cast<unsigned char>(std::get<char>(value));
+                    break;
+                case variable_type::string: {
+                    const auto &string = std::get<std::string>(value);
+                    constant.length = static_cast<std::uint32_t>(string.size());
+                    constant.bits = text.size();
+                    text += string;
+                    break;
+                }
+                default:
+                    // literals are never arrays
+                    std::unreachable();
+            }
+            constants.push_back(constant);
+        }
+        const image_header header{
+            magic, compiled_image_version, key.hash, key.size,
+            static_cast<std::uint32_t>(expression.size()),
+            static_cast<std::uint32_t>(expression.lists().size()),
+            static_cast<std::uint32_t>(constants.size()), 0, text.size()
+        };
+        const image_layout layout{header};
+        const auto put = [&out](const void *data, std::size_t size) {
+            out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        };
+        put(&header, sizeof(header));
+        put(expression.operands().data(), expression.operands().size_bytes());
+        put(expression.lists().data(), expression.lists().size_bytes());
+        constexpr char padding[8]{};
+        put(padding, layout.constants - (layout.lists + expression.lists().size_bytes()));
+        put(constants.data(), constants.size() * sizeof(image_constant));
+        put(expression.kinds().data(), expression.kinds().size_bytes());
+        put(text.data(), text.size());
+    }
+
+    // the expression in `bytes`, which `image` keeps alive and which must
+    // be 8 byte aligned, null unless it is an image of the source of `key`
+    static std::optional<detail::flat_expression> read(script_key key, std::span<const char> bytes,
+                                                        std::shared_ptr<const void> image) {
+        const char *data = bytes.data();
+        const std::size_t size = bytes.size();
+        image_header header;
+        if (size < sizeof(header)) {
+            return std::nullopt;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != magic || header.version != compiled_image_version ||
+            header.source_hash != key.hash || header.source_size != key.size ||
+            header.text_size > size) {
+            return std::nullopt;
+        }
+        const image_layout layout{header};
+        if (layout.end != size) {
+            return std::nullopt;
+        }
+
+        // mappings are page aligned and sections aligned within them
+        std::span<const index_type> operands{reinterpret_cast<const index_type *>(data + layout.operands), header.node_count};
+        std::span<const index_type> lists{reinterpret_cast<const index_type *>(data + layout.lists), header.list_count};
+        std::span<const image_constant> constants{reinterpret_cast<const image_constant *>(data + layout.constants), header.constant_count};
+        std::span<const detail::node_kind> kinds{reinterpret_cast<const detail::node_kind *>(data + layout.kinds), header.node_count};
+        std::string_view text{data + layout.text, header.text_size};
+
+        std::vector<detail::value_t> values;
+        values.reserve(constants.size());
+        for (const image_constant &constant : constants) {
+            switch (static_cast<variable_type>(constant.type)) {
+                case variable_type::integer:
+                    values.emplace_back(static_cast<int32_t>(static_cast<std::uint32_t>(constant.bits)));
+                    break;
+                case variable_type::floating:
+                    values.emplace_back(std::bit_cast<double>(constant.bits));
+                    break;
+                case variable_type::boolean:
+                    values.emplace_back(constant.bits != 0);
+                    break;
+                case variable_type::character:
+                    values.emplace_back(static_cast<char>(constant.bits));
+                    break;
+                case variable_type::string:
+                    if (constant.bits > text.size() || text.size() - constant.bits < constant.length) {
+                        return std::nullopt;
+                    }
+                    values.emplace_back(std::string{text.substr(constant.bits, constant.length)});
+                    break;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        detail::flat_expression expression{kinds, operands, lists, std::move(values), std::move(image)};
+        if (!expression.well_formed()) {
+            return std::nullopt;
+        }
+        return expression;
+    }
+
+ private:
+    using index_type = detail::flat_expression::index_type;
+
+    constexpr static std::uint32_t magic = 0x4943534e;   // "NSCI", in the byte order of the machine that wrote it
+
+    struct image_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t source_hash;
+        std::uint64_t source_size;
+        std::uint32_t node_count;
+        std::uint32_t list_count;
+        std::uint32_t constant_count;
+        std::uint32_t reserved;
+        std::uint64_t text_size;
+    };
+
+    // scalars keep their bits, strings an offset into the text
+    struct image_constant {
+        std::uint32_t type;
+        std::uint32_t length;
+        std::uint64_t bits;
+    };
+
+    // header, operands, lists, constants, kinds, then the text of string
+    // constants, so every section is aligned for what it holds
+    struct image_layout {
+        std::uint64_t operands;
+        std::uint64_t lists;
+        std::uint64_t constants;
+        std::uint64_t kinds;
+        std::uint64_t text;
+        std::uint64_t end;
+
+        explicit image_layout(const image_header &header) noexcept {
+            operands = sizeof(image_header);
+            lists = operands + std::uint64_t{header.node_count} * sizeof(index_type);
+            constants = (lists + std::uint64_t{header.list_count} * sizeof(index_type) + 7) / 8 * 8;
+            kinds = constants + std::uint64_t{header.constant_count} * sizeof(image_constant);
+            text = kinds + std::uint64_t{header.node_count} * sizeof(detail::node_kind);
+            end = text + header.text_size;
+        }
+    };
+
+    std::filesystem::path directory_;
+};
+
+// the expression in `file`, mapped from the cache when it holds an image
+// of the same source, otherwise parsed and then stored there, throws when
+// the file is more than one expression
+inline detail::flat_expression compile_cached(const std::filesystem::path &file, const script_cache &cache) {
+    detail::mmap_input_adapter input{file};
+    const std::string_view source{input.data(), input.size()};
+    const script_key key = script_cache::key(source);
+    if (auto cached = cache.load(key)) {
+        return std::move(*cached);
+    }
+    parser psr{lexer{detail::span_input_adapter{source}}};
+    compiled_expression compiled = psr.compile_expression();
+    psr.match(token_type::end_of_input);
+    detail::flat_expression expression{*compiled.root()};
+    cache.store(key, expression);
+    return expression;
+}
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef NEROLL_SCRIPT_SCRIPT_LOADER_H
+#define NEROLL_SCRIPT_SCRIPT_LOADER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "detail/arena.h"
+#include "detail/input_adapter.h"
+#include "detail/lexer.h"
+#include "parser.h"
+#include "program.h"
+
+namespace neroll::script {
+
+// a script of a batch, either its program or why it could not be loaded
+struct loaded_script {
+    std::filesystem::path path;
+    std::optional<program> script;
+    std::string error;
+};
+
+// maps and parses the script at `path`, its nodes go to `nodes`
+inline loaded_script load_script(const std::filesystem::path &path,
+                                 std::shared_ptr<detail::arena> nodes = std::make_shared<detail::arena>()) {
+    try {
+        return {path, parser{detail::lexer{detail::mmap_input_adapter{path}}, std::move(nodes)}.parse(), {}};
+    } catch (const std::exception &e) {
+        return {path, std::nullopt, e.what()};
+    }
+}
+
+// the scripts at `paths` in the same order, parsed on up to `threads`
+// threads, each taking the next unparsed file until none is left
+//
+// each script has an arena of its own, so it keeps only its own nodes
+// alive, the nodes of a script that fails to parse are freed at once and
+// their chunks go to the next script of the thread
+inline std::vector<loaded_script> load_scripts(std::span<const std::filesystem::path> paths,
+                                               std::size_t threads = std::thread::hardware_concurrency()) {
+    std::vector<loaded_script> scripts(paths.size());
+    std::atomic<std::size_t> next = 0;
+    auto work = [&] {
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < paths.size(); ) {
+            scripts[i] = load_script(paths[i]);
+        }
+    };
+    threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(paths.size(), 1));
+    if (threads == 1) {
+        work();
+        return scripts;
+    }
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t i = 0; i < threads; i++) {
+            workers.emplace_back(work);
+        }
+    }
+    return scripts;
+}
+
+}
+
+#endif
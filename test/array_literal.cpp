@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// a lookup table of `count` squares, the first entry spelled `first`
+std::string generate_table(std::size_t count, std::string_view first) {
+    std::string source = std::format("({{{}", first);
+    for (std::size_t i = 1; i < count; i++) {
+        source += std::format(", {}", i * i % 1000);
+    }
+    return source + std::format("}})[{}]", count - 1);
+}
+
+// evaluates the table `times` times
+void run_table(std::string_view name, std::string_view source, std::size_t times) {
+    auto expression = parser{lexer{span_input_adapter{source}}}.compile_expression();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < times; i++) {
+        expression->evaluate();
+    }
+    double time = milliseconds_since(start);
+    std::println("{:<9} {} evaluations {:>8.1f} ms, {:>7.3f} us each, value {}",
+                 name, times, time, 1000 * time / times, describe(expression->value()));
+}
+
+int main() {
+    // built once when parsed, or again on each evaluation since the first
+    // entry is not a literal
+    run_table("constant", generate_table(4096, "0"), 10000);
+    run_table("computed", generate_table(4096, "0 + 0"), 10000);
+
+    print_expression("{1, 2, 3}");
+    print_expression("({1, 2, 3})[1] * 10");
+    print_expression("({{1, 2}, {3, 4, 5}})[1][2] + 1");
+    print_expression("({{1, 2}, {3, 4 + 1}})");
+    print_expression("({\"lookup\", \"table\"})[1] + \"!\"");
+    print_expression("({(float)1, 2.5})[0]");
+    print_expression("(new int[2][3])[1][2] + 1");
+    print_expression("({1, 2})[2]");
+    print_expression("({})[0]");
+    print_expression("({1, 'a'})[0]");
+    print_expression("({1, 2,})[0]");
+    print_expression("({1, 2");
+
+    // at the start of a statement a brace is a block
+    try {
+        parser{lexer{span_input_adapter{std::string_view{"{1, 2}[0];\n"}}}}.parse();
+    } catch (std::exception &e) {
+        std::println("{:<40} {}", "{1, 2}[0];", e.what());
+    }
+
+    // identical tables share one node
+    constexpr std::string_view twice = "({1, 2, 3})[0];\n({1, 2, 3})[1];\n({1, 2, 4})[2];\n";
+    parser psr{lexer{span_input_adapter{twice}}};
+    psr.set_hash_consing(true);
+    psr.parse();
+    std::println("{} expressions, {} shared", psr.stats().expressions, psr.stats().shared);
+}
@@ -1,51 +1,52 @@
 #include <cstdint>
 #include <format>
-#include <memory>
 #include <print>
+#include "detail/arena.h"
 #include "detail/lexer.h"
 #include "detail/ast.h"
 
 using namespace neroll::script::detail;
 
 int main() {
+    arena nodes;
     try {
-        add_node add(std::make_shared<string_node>("hello"), std::make_shared<string_node>(" world!"));
+        add_node add(nodes.make<string_node>("hello"), nodes.make<string_node>(" world!"));
         add.evaluate();
         std::println("{}", add.get<std::string>());
 
-        logical_and_node logical_and(std::make_shared<boolean_node>(true), std::make_shared<boolean_node>(true));
+        logical_and_node logical_and(nodes.make<boolean_node>(true), nodes.make<boolean_node>(true));
         logical_and.evaluate();
         std::println("{}", logical_and.get<bool>());
 
-        less_node less(std::make_shared<string_node>("aaa"), std::make_shared<string_node>("aab"));
+        less_node less(nodes.make<string_node>("aaa"), nodes.make<string_node>("aab"));
         less.evaluate();
         std::println("{}", less.get<bool>());
 
-        logical_not_node not_node(std::make_shared<boolean_node>(true));
+        logical_not_node not_node(nodes.make<boolean_node>(true));
         not_node.evaluate();
         std::println("{}", not_node.get<bool>());
 
-        bit_and_node and_node(std::make_shared<int_node>(3), std::make_shared<int_node>(1));
+        bit_and_node and_node(nodes.make<int_node>(3), nodes.make<int_node>(1));
         and_node.evaluate();
         std::println("{}", and_node.get<int32_t>());
 
-        bit_or_node or_node(std::make_shared<int_node>(3), std::make_shared<int_node>(4));
+        bit_or_node or_node(nodes.make<int_node>(3), nodes.make<int_node>(4));
         or_node.evaluate();
         std::println("{}", or_node.get<int32_t>());
 
-        bit_xor_node xor_node(std::make_shared<int_node>(3), std::make_shared<int_node>(1));
+        bit_xor_node xor_node(nodes.make<int_node>(3), nodes.make<int_node>(1));
         xor_node.evaluate();
         std::println("{}", xor_node.get<int32_t>());
 
-        bit_not_node bnot(std::make_shared<int_node>(0));
+        bit_not_node bnot(nodes.make<int_node>(0));
         bnot.evaluate();
         std::println("{}", bnot.get<int32_t>());
 
-        shift_left_node sleft(std::make_shared<int_node>(1), std::make_shared<int_node>(3));
+        shift_left_node sleft(nodes.make<int_node>(1), nodes.make<int_node>(3));
         sleft.evaluate();
         std::println("{}", sleft.get<int32_t>());
 
-        shift_right_node sright(std::make_shared<int_node>(8), std::make_shared<int_node>(3));
+        shift_right_node sright(nodes.make<int_node>(8), nodes.make<int_node>(3));
         sright.evaluate();
         std::println("{}", sright.get<int32_t>());
     }
@@ -0,0 +1,64 @@
+#ifndef NEROLL_SCRIPT_TEST_COMMON_H
+#define NEROLL_SCRIPT_TEST_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include "parser.h"
+
+// helpers shared by the tests, each test is still a program of its own
+
+inline double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline std::string read_file(const std::filesystem::path &file) {
+    std::ifstream fin(file, std::ios::binary);
+    return {std::istreambuf_iterator<char>(fin), {}};
+}
+
+inline void write_file(const std::filesystem::path &file, std::string_view text) {
+    std::ofstream(file, std::ios::binary) << text;
+}
+
+// a value as text, arrays with their elements in braces
+inline std::string describe(const neroll::script::detail::value_t &value) {
+    return std::visit([](const auto &scalar) -> std::string {
+        if constexpr (std::is_same_v<std::decay_t<decltype(scalar)>, neroll::script::detail::array>) {
+            std::string text = "{";
+            for (std::size_t i = 0; i < scalar.size(); i++) {
+                text += (i == 0 ? "" : ", ") + describe(scalar[i]);
+            }
+            return text + "}";
+        } else {
+            return std::format("{}", scalar);
+        }
+    }, value);
+}
+
+// parses and evaluates the expression `source`, then prints it with its
+// value or with the error it raised
+inline void print_expression(std::string_view source, std::size_t width = 40) {
+    using namespace neroll::script::detail;
+    std::string padded{source};
+    padded.resize(std::max(padded.size(), width), ' ');
+    try {
+        auto expression = neroll::script::parser{lexer{span_input_adapter{source}}}.compile_expression();
+        expression->evaluate();
+        std::println("{} {}", padded, describe(expression->value()));
+    } catch (std::exception &e) {
+        std::println("{} {}", padded, e.what());
+    }
+}
+
+#endif
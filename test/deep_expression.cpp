@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "detail/flat_ast.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// `count` ones added left to right, the tree is a chain down its left side
+std::string generate_sum(std::size_t count) {
+    std::string source = "1";
+    for (std::size_t i = 1; i < count; i++) {
+        source += "+1";
+    }
+    return source;
+}
+
+// `count` ones added right to left, each addition one parenthesis deeper
+std::string generate_nested_sum(std::size_t count) {
+    std::string source;
+    for (std::size_t i = 1; i < count; i++) {
+        source += "1+(";
+    }
+    source += "1";
+    source.append(count - 1, ')');
+    return source;
+}
+
+std::string generate_parentheses(std::size_t count) {
+    return std::string(count, '(') + "1" + std::string(count, ')');
+}
+
+std::string generate_negations(std::size_t count) {
+    std::string source;
+    for (std::size_t i = 0; i < count; i++) {
+        source += "- ";
+    }
+    return source + "1";
+}
+
+// parses and evaluates `source`, returns the time both took
+double run(std::string_view name, std::size_t count, std::string_view source, std::size_t max_depth) {
+    try {
+        auto start = std::chrono::steady_clock::now();
+        parser psr{lexer{span_input_adapter{source}}};
+        psr.set_max_depth(max_depth);
+        auto expression = psr.compile_expression();
+        double parse_time = milliseconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        expression->evaluate();
+        double evaluate_time = milliseconds_since(start);
+        std::println("{:<10} {:>8} terms, parse {:>7.1f} ms, evaluate {:>6.1f} ms, value {}",
+                     name, count, parse_time, evaluate_time, describe(expression->value()));
+        return parse_time + evaluate_time;
+    } catch (std::exception &e) {
+        std::println("{:<10} {:>8} terms, {}", name, count, e.what());
+        return 0;
+    }
+}
+
+// lowers `source` to the flat layout and evaluates that
+void run_flat(std::string_view name, std::size_t count, std::string_view source) {
+    try {
+        parser psr{lexer{span_input_adapter{source}}};
+        psr.set_max_depth(2 * count);
+        auto expression = psr.compile_expression();
+        auto start = std::chrono::steady_clock::now();
+        flat_expression flat{*expression.root()};
+        double lower_time = milliseconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        value_t value = flat.evaluate();
+        double evaluate_time = milliseconds_since(start);
+        std::println("{:<10} {:>8} terms, flat lower {:>7.1f} ms, evaluate {:>6.1f} ms, value {}",
+                     name, count, lower_time, evaluate_time, describe(value));
+    } catch (std::exception &e) {
+        std::println("{:<10} {:>8} terms, flat {}", name, count, e.what());
+    }
+}
+
+int main() {
+    constexpr std::size_t million = 1'000'000;
+    using generator = std::string (*)(std::size_t);
+    constexpr std::pair<std::string_view, generator> shapes[]{
+        {"sum", generate_sum},
+        {"nested", generate_nested_sum},
+        {"parens", generate_parentheses},
+        {"negations", generate_negations},
+    };
+    // a quarter of the input should take about a quarter of the time
+    for (auto [name, generate] : shapes) {
+        double quarter = run(name, million / 4, generate(million / 4), 2 * million);
+        double full = run(name, million, generate(million), 2 * million);
+        std::println("{:<10} {:.2f} times the time for 4 times the terms", name, full / quarter);
+    }
+
+    // the flat layout is lowered and evaluated without recursion too
+    for (auto [name, generate] : shapes) {
+        run_flat(name, million, generate(million));
+    }
+    run_flat("and", 2, "false && 1 / 0 == 0");
+    run_flat("or", 3, "true || 1 / 0 == 0 && false");
+    run_flat("array", 4, "(new int[2][3][4])[1][2][3] + 1");
+
+    // the default limit, and nesting that still takes native stack
+    run("parens", million, generate_parentheses(million), parser<lexer_token_source<span_input_adapter>>::default_max_depth);
+    run("parens", 100, generate_parentheses(100), 50);
+    std::string indexes = "0";
+    for (std::size_t i = 0; i < 5000; i++) {
+        indexes = "(new int[1])[" + indexes + "]";
+    }
+    run("indexes", 5000, indexes, 2 * million);
+
+    std::string blocks = std::string(5000, '{') + std::string(5000, '}');
+    try {
+        parser{lexer{span_input_adapter{std::string_view{blocks}}}}.parse();
+        std::println("blocks         5000 deep, parsed");
+    } catch (std::exception &e) {
+        std::println("blocks         5000 deep, {}", e.what());
+    }
+
+    // the right side of && and || is still skipped
+    run("and", 2, "false && 1 / 0 == 0", 2 * million);
+    run("or", 2, "true || 1 / 0 == 0", 2 * million);
+    run("cast", 3, "(int)(float)7 / 2 + -(int)2.5 * -(1 + 1)", 2 * million);
+}
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <exception>
+#include <print>
+#include <string_view>
+#include "parser.h"
+#include "detail/flat_ast.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+void print_value(const value_t &value) {
+    switch (static_cast<variable_type>(value.index())) {
+        case variable_type::integer:
+            std::println("{}", std::get<int32_t>(value));
+            break;
+        case variable_type::floating:
+            std::println("{}", std::get<double>(value));
+            break;
+        case variable_type::boolean:
+            std::println("{}", std::get<bool>(value));
+            break;
+        case variable_type::string:
+            std::println("{}", std::get<std::string>(value));
+            break;
+        case variable_type::character:
+            std::println("{}", std::get<char>(value));
+            break;
+        case variable_type::array:
+            std::println("array of {}", std::get<array>(value).size());
+            break;
+        default:
+            std::unreachable();
+    }
+}
+
+int main() {
+    constexpr std::string_view sources[]{
+        "1 + 2 * 3 - 4 / 2",
+        "(1 << 4) | 3 ^ ~0 & 7",
+        "(float)7 / 2 >= 3.5 && !(2 > 3)",
+        "\"flat\" + \" ast\"",
+        "(new int[3][5])[2]",
+        "false && 1 / 0 == 1",
+        "1 / (2 - 2)",
+        "(new int[2])[1 - 2]",
+        "(new int[2])[2]",
+        "(new int[2])[1]",
+    };
+    for (std::string_view source : sources) {
+        try {
+            auto expression = parser{lexer{span_input_adapter{source}}}.compile_expression();
+            flat_expression flat{*expression.root()};
+            std::print("{} nodes, {} constants: ", flat.size(), flat.constants().size());
+            print_value(flat.evaluate());
+        } catch (std::exception &e) {
+            std::println("{}", e.what());
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// what a code generator emits, the same index arithmetic and casts over
+// and over with a few distinct constants
+std::string generate_script(std::size_t lines) {
+    std::string source;
+    for (std::size_t i = 0; i < lines; i++) {
+        source += std::format(
+            "(new int[16])[({} * 4 + {}) % 16] + (int)((float){} * 2.5) - (int)((float){} * 2.5);\n"
+            "\"row \" + \"{}\" == \"row \" + \"{}\" && -({} << 2) < ~{};\n",
+            i % 3, i % 5, i % 7, i % 7, i % 2, i % 2, i % 11, i % 13);
+    }
+    return source;
+}
+
+// parses and runs `source`, returns the values of its statements
+std::vector<std::string> run(std::string_view name, std::string_view source, bool hash_consing) {
+    std::vector<std::string> values;
+    try {
+        auto start = std::chrono::steady_clock::now();
+        parser psr{lexer{span_input_adapter{source}}};
+        psr.set_hash_consing(hash_consing);
+        program script = psr.parse();
+        double parse_time = milliseconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (const statement_extent &statement : script.statements()) {
+            if (statement.statement->kind() == node_kind::function_declaration) {
+                continue;
+            }
+            auto *expr = static_cast<expr_stat_node *>(statement.statement)->expr();
+            expr->evaluate();
+            values.push_back(describe(expr->value()));
+        }
+        double run_time = milliseconds_since(start);
+
+        const parse_stats &stats = psr.stats();
+        std::println("{:<8} {:<5} {:>7} expressions, {:>7} nodes made, {:>5.1f}% fewer, "
+                     "nodes take {:>9} bytes, parse {:>6.1f} ms, run {:>6.1f} ms",
+                     name, hash_consing ? "on" : "off", stats.expressions, stats.expressions - stats.shared,
+                     100.0 * stats.shared / std::max<std::size_t>(stats.expressions, 1),
+                     script.bytes(), parse_time, run_time);
+    } catch (std::exception &e) {
+        std::println("{:<8} {:<5} {}", name, hash_consing ? "on" : "off", e.what());
+    }
+    return values;
+}
+
+int main() {
+    std::string source = generate_script(20000);
+    std::println("input: {} bytes", source.size());
+    std::vector<std::string> plain = run("large", source, false);
+    std::vector<std::string> shared = run("large", source, true);
+    std::println("same values: {}, e.g. {} and {}", plain == shared, shared.at(0), shared.at(1));
+
+    // a shared operand still evaluates to its value under each parent
+    constexpr std::string_view small = "(1 + 2) * (1 + 2) - (1 + 2);\n(float)3 / (float)3 + (float)3;\n\"a\" + \"a\";\n";
+    for (const std::string &value : run("small", small, true)) {
+        std::println("    {}", value);
+    }
+    // holes and function bodies, deferred or not, share the table
+    constexpr std::string_view nested =
+        "function f(): int { return (1 + 2) * (1 + 2); }\n"
+        "$\"{1 + 2} and {(1 + 2) * (1 + 2)}\" + \"\";\n"
+        "f() + (1 + 2) * (1 + 2);\n";
+    for (const std::string &value : run("nested", nested, true)) {
+        std::println("    {}", value);
+    }
+    constexpr std::string_view wrong = "1 + 2;\n(1 + 2) + \"x\";\n";
+    run("wrong", wrong, true);
+}
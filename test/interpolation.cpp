@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// evaluates `source` `times` times
+void run_many(std::string_view name, std::string_view source, std::size_t times) {
+    auto expression = parser{lexer{span_input_adapter{source}}}.compile_expression();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < times; i++) {
+        expression->evaluate();
+    }
+    double time = milliseconds_since(start);
+    std::println("{:<13} {} evaluations {:>7.1f} ms, {:>6.3f} us each: {}",
+                 name, times, time, 1000 * time / times, expression->get<std::string>());
+}
+
+int main() {
+    // the same text, by a chain of `+` and by one interpolated string
+    constexpr std::string_view chain =
+        R"("name=" + "widget" + " kind=" + "gear" + " shop=" + "north" + " state=" + "ok")";
+    constexpr std::string_view interpolated =
+        R"($"name={\"widget\"} kind={\"gear\"} shop={\"north\"} state={\"ok\"}")";
+    run_many("+ chain", chain, 200000);
+    run_many("interpolated", interpolated, 200000);
+    run_many("numbers", R"($"id={40 + 2} v={2.5 * 3} big={-2147483647 - 1} tiny={1.0 / 3.0}")", 200000);
+
+    print_expression(R"($"plain text")", 48);
+    print_expression(R"($"id={1 + 2} ok={1 < 2} c={'x'} s={\"a\" + \"b\"}")", 48);
+    print_expression(R"($"{{braces}} and {({1, 2, 3})[2]}")", 48);
+    print_expression(R"($"{(float)1}|{0.1 + 0.2}|{(int)2.9}|{-0.0}")", 48);
+    print_expression(R"($"nested {$\"inner {1 + 1}\"}" + "!")", 48);
+    print_expression(R"($"{new int[2]}")", 48);
+    print_expression(R"($"{1 +}")", 48);
+    print_expression(R"($"{1")", 48);
+    print_expression(R"($"a } b")", 48);
+    print_expression(R"($"{}")", 48);
+    print_expression(R"($"a {  } b")", 48);
+    print_expression(R"($ "space")", 48);
+    // a string in a hole is written with \", a plain quote ends the text
+    print_expression(R"($"s={\"in\"}")", 48);
+    print_expression(R"($"s={"in"}")", 48);
+    print_expression(R"($"q={\"say \\\"hi\\\" {}\"}")", 48);
+
+    // positions inside a hole count from where it is in the source
+    constexpr std::string_view script = "1;\n  $\"x={undefined()}\";\n";
+    try {
+        parser{lexer{span_input_adapter{script}}}.parse();
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+    constexpr std::string_view typo = "1;\n  $\"x={1 2}\";\n";
+    try {
+        parser{lexer{span_input_adapter{typo}}}.parse();
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+    // and count an escape before them as the two characters it is written in
+    for (std::string_view source : {R"($"a\tb } c")", R"($"\t{1 2}")", R"($"\"q\" {1 + (2}")"}) {
+        print_expression(source, 48);
+    }
+}
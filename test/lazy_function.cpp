@@ -0,0 +1,151 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// a library of `count` functions, then calls of a few of them
+std::string generate_library(std::size_t count) {
+    std::string source;
+    for (std::size_t i = 0; i < count; i++) {
+        source += std::format(
+            "function f{}(int a, float b): int {{\n"
+            "    (float){} * 2.5 + {} / 3.0;\n"
+            "    {{ \"{{nested}}\" + \"block\"; {} << 2; }}\n"
+            "    return ({} + {}) * {} - {} % 7;\n"
+            "}}\n", i, i, i % 17, i % 31, i, i % 13, i % 5, i);
+    }
+    source += "f0(1, 2.0);\n";
+    source += std::format("f{}(3, 4.0) + f{}(5, 6.0);\n", count / 2, count - 1);
+    return source;
+}
+
+// parses `source`, then runs it and prints the value of each call
+void run(std::string_view name, std::string_view source, bool lazy) {
+    const std::string_view mode = lazy ? "lazy" : "eager";
+    auto start = std::chrono::steady_clock::now();
+    parser psr{lexer{span_input_adapter{source}}};
+    psr.set_lazy_function_bodies(lazy);
+    std::optional<program> loaded;
+    try {
+        loaded = psr.parse();
+    } catch (std::exception &e) {
+        std::println("{:<6} {:<5} load: {}", name, mode, e.what());
+        return;
+    }
+    program &script = *loaded;
+    double load_time = milliseconds_since(start);
+    std::size_t bytes = script.bytes();
+    try {
+        start = std::chrono::steady_clock::now();
+        script->execute();
+        double run_time = milliseconds_since(start);
+
+        std::size_t parsed = 0;
+        std::string values;
+        for (const statement_extent &statement : script.statements()) {
+            if (statement.statement->kind() == node_kind::function_declaration) {
+                parsed += static_cast<const function_node *>(statement.statement)->parsed();
+            } else {
+                values += std::format(" {}", static_cast<expr_stat_node *>(statement.statement)->expr()->get<int32_t>());
+            }
+        }
+        std::println("{:<6} {:<5} load {:>7.2f} ms, run {:>6.3f} ms, nodes take {:>9} bytes, {} bodies parsed, values{}",
+                     name, mode, load_time, run_time, bytes, parsed, values);
+    } catch (std::exception &e) {
+        std::println("{:<6} {:<5} run: {}", name, mode, e.what());
+    }
+}
+
+// parses `source` with a depth limit and hash consing, runs it, then
+// prints what the parser counted
+void run_counted(std::string_view name, std::string_view source, bool lazy, std::size_t max_depth) {
+    const std::string_view mode = lazy ? "lazy" : "eager";
+    parser psr{lexer{span_input_adapter{source}}};
+    psr.set_lazy_function_bodies(lazy);
+    psr.set_max_depth(max_depth);
+    psr.set_hash_consing(true);
+    try {
+        program script = psr.parse();
+        script->execute();
+        std::println("{:<6} {:<5} {} expressions, {} shared", name, mode, psr.stats().expressions, psr.stats().shared);
+    } catch (std::exception &e) {
+        std::println("{:<6} {:<5} {}", name, mode, e.what());
+    }
+}
+
+int main() {
+    std::string library = generate_library(20000);
+    std::println("input: {} bytes", library.size());
+    run("large", library, false);
+    run("large", library, true);
+
+    constexpr std::string_view broken =
+        "function ok(): int { return 1; }\n"
+        "function bad(char c): int {\n"
+        "    return 1.5;\n"
+        "}\n"
+        "ok();\n"
+        "bad('x');\n";
+    run("broken", broken, true);
+    run("broken", broken, false);
+
+    // the same position either way
+    constexpr std::string_view misplaced =
+        "function ok(): int { return 1; }\n"
+        "\n"
+        "function typo(): int {\n"
+        "    { \"}\"; '{'; }\n"
+        "    return 1 2;\n"
+        "}\n"
+        "typo();\n";
+    run("typo", misplaced, true);
+    run("typo", misplaced, false);
+
+    constexpr std::string_view later =
+        "function first(): int { return second(); }\n"
+        "function second(): int { return 2; }\n"
+        "first();\n";
+    run("later", later, true);
+    run("later", later, false);
+
+    // with no conditionals a call to itself never ends
+    constexpr std::string_view recursive =
+        "function f(): int { return f() + 1; }\n"
+        "f();\n";
+    run("self", recursive, true);
+    run("self", recursive, false);
+
+    // a deferred body is parsed as the parser was set up, and counted by it
+    const std::string deep = std::format("function deep(): int {{ return {}1{}; }}\ndeep();\n",
+                                         std::string(50, '('), std::string(50, ')'));
+    const std::string_view repeated =
+        "function f(): int { return (1 + 2) * (1 + 2) - (1 + 2); }\n"
+        "f();\n";
+    for (bool lazy : {false, true}) {
+        run_counted("deep", deep, lazy, 10);
+        run_counted("shared", repeated, lazy, 10);
+    }
+
+    constexpr std::string_view mistakes[]{
+        "function f(): int { return 1;\n",
+        "function f(): int { return 1; }\nfunction f(): int { return 2; }\n",
+        "function f(int a): int { return 1; }\nf(1.5);\n",
+        "function f(): int { return 1; }\nf(1);\n",
+        "function f(): int { function g(): int { return 1; } return 2; }\nf();\n",
+        "function f(): int { 1; }\nf();\n",
+        "return 1;\n",
+        "int x;\n",
+    };
+    for (std::string_view source : mistakes) {
+        run("error", source, true);
+    }
+}
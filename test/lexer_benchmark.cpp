@@ -0,0 +1,159 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+
+#include "detail/lexer.h"
+#include "detail/scan.h"
+#include "detail/token_stream.h"
+
+using namespace neroll::script::detail;
+
+std::filesystem::path generate_script(std::size_t bytes) {
+    auto file = std::filesystem::temp_directory_path() / "nscript_lexer_benchmark.txt";
+    std::ofstream fout(file, std::ios::binary);
+    std::string line;
+    std::size_t written = 0;
+    for (std::size_t i = 0; written < bytes; i++) {
+        line = std::format("    int value_{} = (table_{}[{}] + 4.5e3) * {} >= \"entry {}\";\n", i % 4096, i % 97, i % 13, i, i);
+        fout << line;
+        written += line.size();
+    }
+    return file;
+}
+
+// long string literals, every fourth with escapes
+std::filesystem::path generate_text_blobs(std::size_t bytes) {
+    auto file = std::filesystem::temp_directory_path() / "nscript_lexer_benchmark_blobs.txt";
+    std::ofstream fout(file, std::ios::binary);
+    std::string text;
+    for (std::size_t i = 0; text.size() < 8000; i++) {
+        text += std::format("lorem ipsum {} dolor sit amet ", i);
+    }
+    std::string escaped = text;
+    for (std::size_t i = 0; i + 1 < escaped.size(); i += 100) {
+        escaped[i] = '\\';
+        escaped[i + 1] = 'n';
+    }
+    std::size_t written = 0;
+    for (std::size_t i = 0; written < bytes; i++) {
+        std::string line = std::format("string text_{} = \"{}\";\n", i, i % 4 == 0 ? escaped : text);
+        fout << line;
+        written += line.size();
+    }
+    return file;
+}
+
+template <typename InputAdapter>
+std::size_t lex_all(lexer<InputAdapter> &lex) {
+    std::size_t count = 0;
+    while (lex.next_token().type != token_type::end_of_input) {
+        count++;
+    }
+    return count;
+}
+
+// lines of prose, `localized` ones are mostly outside ASCII
+std::string generate_text(std::size_t bytes, bool localized) {
+    constexpr std::string_view ascii_words[]{"lorem", "ipsum", "dolor", "sit", "amet", "consectetur"};
+    constexpr std::string_view localized_words[]{"größe", "値段", "значение", "描述", "ελληνικά", "sit"};
+    std::string text;
+    for (std::size_t i = 0; text.size() < bytes; i++) {
+        text += localized ? localized_words[i % 6] : ascii_words[i % 6];
+        text += i % 12 == 11 ? '\n' : ' ';
+    }
+    return text;
+}
+
+template <typename Function>
+void measure(std::string_view name, std::size_t bytes, Function function, std::string_view unit = "tokens") {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t count = function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::println("{:<10} {:>10} {:<6}  {:>8.1f} MB/s", name, count, unit, bytes / 1e6 / elapsed.count());
+}
+
+// string literal scanning, which validates UTF-8, stopping at each newline
+template <typename Kernel>
+std::size_t scan_lines(const std::string &text, Kernel kernel) {
+    std::size_t lines = 0;
+    const char *end = text.data() + text.size();
+    for (const char *p = text.data(); (p = kernel(p, end)) != end; p++) {
+        lines++;
+    }
+    return lines;
+}
+
+int main() {
+    auto file = generate_script(32 << 20);
+    auto bytes = std::filesystem::file_size(file);
+    std::println("input: {} bytes", bytes);
+
+    measure("istream", bytes, [&] {
+        std::ifstream fin(file, std::ios::binary);
+        lexer lex(input_stream_adapter{fin});
+        return lex_all(lex);
+    });
+
+    measure("buffered", bytes, [&] {
+        std::ifstream fin(file, std::ios::binary);
+        lexer lex(buffered_stream_adapter{fin});
+        return lex_all(lex);
+    });
+
+    measure("mmap", bytes, [&] {
+        lexer lex(mmap_input_adapter{file});
+        return lex_all(lex);
+    });
+
+    measure("prelexed", bytes, [&] {
+        token_stream stream{lexer{mmap_input_adapter{file}}};
+        return stream.size();
+    });
+
+    for (std::size_t threads : {1, 2, 4, 8, 16}) {
+        measure(std::format("{} threads", threads), bytes, [&] {
+            token_stream stream{lexer{mmap_input_adapter{file}}, threads};
+            return stream.size();
+        });
+    }
+
+    std::string source(bytes, '\0');
+    std::ifstream(file, std::ios::binary).read(source.data(), static_cast<std::streamsize>(bytes));
+    measure("span", bytes, [&] {
+        lexer lex(span_input_adapter{std::string_view{source}});
+        return lex_all(lex);
+    });
+
+    std::filesystem::remove(file);
+
+    auto blobs = generate_text_blobs(32 << 20);
+    auto blob_bytes = std::filesystem::file_size(blobs);
+    std::println("text blobs: {} bytes", blob_bytes);
+
+    measure("istream", blob_bytes, [&] {
+        std::ifstream fin(blobs, std::ios::binary);
+        lexer lex(input_stream_adapter{fin});
+        return lex_all(lex);
+    });
+
+    measure("mmap", blob_bytes, [&] {
+        lexer lex(mmap_input_adapter{blobs});
+        return lex_all(lex);
+    });
+
+    std::filesystem::remove(blobs);
+
+    for (bool localized : {false, true}) {
+        std::string text = generate_text(32 << 20, localized);
+        std::println("{} text: {} bytes", localized ? "localized" : "ascii", text.size());
+        measure("blocks", text.size(), [&] {
+            return scan_lines(text, scan::string_special);
+        }, "lines");
+        measure("per-char", text.size(), [&] {
+            return scan_lines(text, scan::scalar::string_special);
+        }, "lines");
+    }
+}
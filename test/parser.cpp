@@ -16,7 +16,7 @@ int main() {
     parser psr{detail::lexer{detail::input_stream_adapter{fin}}};
 
     try {
-        auto node = psr.parse_logical_or();
+        auto node = psr.parse_expression();
         node->evaluate();
         auto arr = node->get<array>();
 
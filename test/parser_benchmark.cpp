@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <print>
+#include <string>
+#include "parser.h"
+#include "detail/flat_ast.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// balanced expression over 2^depth ones, so the tree stays shallow
+std::string generate_expression(std::size_t depth) {
+    if (depth == 0) {
+        return "1";
+    }
+    std::string half = generate_expression(depth - 1);
+    constexpr std::string_view operators[]{" *\n ", " + ", " - "};
+    return std::format("({}{}{})", half, operators[depth % 3], half);
+}
+
+// peak resident set size in kB
+long peak_rss() {
+    std::ifstream fin("/proc/self/status");
+    std::string line;
+    while (std::getline(fin, line)) {
+        if (line.starts_with("VmHWM:")) {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::string source = generate_expression(20);
+    std::println("input: {} bytes", source.size());
+    long rss = peak_rss();
+
+    auto start = std::chrono::steady_clock::now();
+    auto expression = parser{lexer{span_input_adapter{std::string_view{source}}}}.compile_expression();
+    std::println("parse     {:>8.1f} ms, nodes take {} bytes", milliseconds_since(start), expression.bytes());
+
+    start = std::chrono::steady_clock::now();
+    expression->evaluate();
+    std::println("evaluate  {:>8.1f} ms, value {}", milliseconds_since(start), expression->get<int32_t>());
+
+    start = std::chrono::steady_clock::now();
+    flat_expression flat{*expression.root()};
+    std::println("flatten   {:>8.1f} ms, layout takes {} bytes", milliseconds_since(start), flat.bytes());
+
+    start = std::chrono::steady_clock::now();
+    value_t value = flat.evaluate();
+    std::println("flat eval {:>8.1f} ms, value {}", milliseconds_since(start), std::get<int32_t>(value));
+
+    start = std::chrono::steady_clock::now();
+    expression = compiled_expression{arena{}, nullptr};
+    std::println("teardown  {:>8.1f} ms", milliseconds_since(start));
+
+    std::println("peak rss  {:>8} kB more", peak_rss() - rss);
+}
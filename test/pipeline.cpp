@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+#include "parser.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// balanced sum of 2^depth ones, so the tree stays shallow
+std::string generate_sum(std::size_t depth) {
+    if (depth == 0) {
+        return "1";
+    }
+    std::string half = generate_sum(depth - 1);
+    return std::format("({} +\n {})", half, half);
+}
+
+template <typename Function>
+void measure(std::string_view name, std::size_t bytes, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    int32_t value = function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::println("{:<10} value {:>8}  {:>8.1f} MB/s", name, value, bytes / 1e6 / elapsed.count());
+}
+
+int main() {
+    try {
+        parser psr{pipelined{lexer{mmap_input_adapter{"../../../../script/main.txt"}}}};
+        auto node = psr.parse_expression();
+        node->evaluate();
+        std::println("value: {}", node->get<int32_t>());
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+
+    // errors surface at the same token as without the pipeline
+    for (std::string_view source : {"1 + 2 * 3 @ 4", "1 + (2 * 3", "(1 +\n 2) *\n 3 3", "\"abc\n\""}) {
+        try {
+            parser psr{pipelined{lexer{span_input_adapter{source}}}};
+            psr.parse_expression();
+            psr.match(token_type::end_of_input);
+            std::println("parsed");
+        } catch (std::exception &e) {
+            std::println("{}", e.what());
+        }
+        try {
+            parser psr{lexer{span_input_adapter{source}}};
+            psr.parse_expression();
+            psr.match(token_type::end_of_input);
+            std::println("parsed");
+        } catch (std::exception &e) {
+            std::println("{}", e.what());
+        }
+    }
+
+    std::string source = generate_sum(18);
+    std::println("input: {} bytes", source.size());
+    auto evaluate = [](auto &psr) {
+        auto node = psr.parse_expression();
+        node->evaluate();
+        return node->template get<int32_t>();
+    };
+    measure("serial", source.size(), [&] {
+        parser psr{lexer{span_input_adapter{std::string_view{source}}}};
+        return evaluate(psr);
+    });
+    measure("pipelined", source.size(), [&] {
+        parser psr{pipelined{lexer{span_input_adapter{std::string_view{source}}}}};
+        return evaluate(psr);
+    });
+}
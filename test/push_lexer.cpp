@@ -0,0 +1,62 @@
+#include <exception>
+#include <fstream>
+#include <initializer_list>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "detail/push_lexer.h"
+
+using namespace neroll::script::detail;
+
+// the tokens of `chunks` as they come, then the error that stops them
+void feed_all(std::initializer_list<std::string_view> chunks) {
+    push_lexer lex;
+    try {
+        for (std::string_view chunk : chunks) {
+            for (const token &tok : lex.feed(chunk)) {
+                std::print("{} ", tok);
+            }
+        }
+        for (const token &tok : lex.finish()) {
+            std::print("{} ", tok);
+        }
+        std::println("");
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+}
+
+int main() {
+    // the tokens before an error are returned first, as the lexer does
+    feed_all({"1 + 2 ", "+ 3 @ 4"});
+    feed_all({"1 + 2 + 3 @", " 4"});
+
+    std::ifstream fin("../../../../script/main.txt");
+    if (!fin.is_open()) {
+        std::println("cannot open file");
+        exit(EXIT_FAILURE);
+    }
+    std::stringstream buffer;
+    buffer << fin.rdbuf();
+    const std::string source = buffer.str();
+
+    try {
+        // chunks of 3 bytes split `new`, `int` and the `[3]` groups
+        push_lexer lex;
+        for (std::size_t i = 0; i < source.size(); i += 3) {
+            for (const token &tok : lex.feed(std::string_view{source}.substr(i, 3))) {
+                std::print("{} ", tok);
+            }
+            std::println("| after {} bytes", std::min(i + 3, source.size()));
+        }
+        for (const token &tok : lex.finish()) {
+            std::print("{} ", tok);
+        }
+        std::println("");
+    }
+    catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include "detail/flat_ast.h"
+#include "reparse.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// expression statements, empty ones and blocks, one per line
+std::string generate_script(std::size_t lines) {
+    std::string source;
+    for (std::size_t i = 0; i < lines; i++) {
+        switch (i % 5) {
+            case 0:
+                source += std::format("({} + {}) * {} - {} / 7;\n", i, i % 13, i % 7, i);
+                break;
+            case 1:
+                source += std::format("{{ {} << 2; (float){} >= 2.5; }}\n", i % 31, i);
+                break;
+            case 2:
+                source += std::format("\"line {}\" + \" of the script\";\n", i);
+                break;
+            case 3:
+                source += std::format("(new int[{}])[{}] == 0 && !false;\n", i % 9 + 1, i % 9);
+                break;
+            default:
+                source += ";\n";
+                break;
+        }
+    }
+    return source;
+}
+
+// the kinds and value of each expression, blocks in braces
+std::string describe(const statement_node *statement) {
+    if (statement->kind() == node_kind::block) {
+        std::string text = "{";
+        for (const statement_node *nested : static_cast<const block_node *>(statement)->statements()) {
+            text += describe(nested);
+        }
+        return text + "}";
+    }
+    const expr_node *expr = static_cast<const expr_stat_node *>(statement)->expr();
+    if (expr == nullptr) {
+        return ";";
+    }
+    flat_expression flat{*expr};
+    std::string text;
+    for (node_kind kind : flat.kinds()) {
+        text += std::format("{} ", static_cast<int>(kind));
+    }
+    return std::format("{}= {};", text, describe(flat.evaluate()));
+}
+
+std::string describe(const program &script) {
+    std::string text;
+    for (const statement_extent &statement : script.statements()) {
+        text += std::format("{}@{} ", describe(statement.statement), statement.end);
+    }
+    return text;
+}
+
+// applies the edit to `source` and reparses, then checks the result
+// against a full parse of the edited source, an edit that does not parse
+// is undone
+void edit(std::string &source, program &script, std::string_view name,
+          std::size_t offset, std::size_t removed, std::string_view inserted) {
+    std::string original = source;
+    source.replace(offset, removed, inserted);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        program edited = reparse(script, source, {offset, removed, inserted.size()});
+        double reparse_time = milliseconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        program full = parser{lexer{span_input_adapter{std::string_view{source}}}}.parse();
+        double full_time = milliseconds_since(start);
+
+        std::unordered_set<const statement_node *> old;
+        for (const statement_extent &statement : script.statements()) {
+            old.insert(statement.statement);
+        }
+        std::size_t parsed = 0;
+        for (const statement_extent &statement : edited.statements()) {
+            parsed += !old.contains(statement.statement);
+        }
+        std::println("{:<14} {} statements, {} parsed again, same as full parse: {}",
+                     name, edited.statements().size(), parsed, describe(edited) == describe(full));
+        std::println("{:<14} reparse {:.3f} ms, full parse {:.1f} ms", "", reparse_time, full_time);
+        script = std::move(edited);
+    } catch (std::exception &e) {
+        std::println("{:<14} {}", name, e.what());
+        source = std::move(original);
+    }
+}
+
+int main() {
+    std::string source = generate_script(50000);
+    std::println("input: {} bytes", source.size());
+    program script = parser{lexer{span_input_adapter{std::string_view{source}}}}.parse();
+
+    std::size_t middle = source.find("25000 + ");
+    edit(source, script, "change literal", middle + 1, 1, "7");
+    edit(source, script, "insert line", source.find("\n", middle) + 1, 0, "1 + 2 * 3;\n");
+    std::size_t line = source.find("{ ", middle);
+    edit(source, script, "delete line", line, source.find('\n', line) + 1 - line, "");
+    std::size_t string = source.find("\"line 25002\"");
+    edit(source, script, "edit string", string + 5, 0, "number ");
+    edit(source, script, "join lines", source.find(";\n", middle), 2, " +\n");
+    edit(source, script, "split line", source.find("*", middle), 1, ";\n1 *");
+    edit(source, script, "first line", 1, 0, "1 + ");
+    edit(source, script, "last line", source.rfind("== 0") + 4, 0, " || true");
+    edit(source, script, "append", source.size(), 0, "1 + 1;");
+    edit(source, script, "whitespace", source.find("\n", middle), 0, "\n\n   ");
+    edit(source, script, "unbalanced", source.find("{ ", middle), 1, "");
+    edit(source, script, "empty", 0, source.size(), "");
+    edit(source, script, "new script", 0, 0, "1; { 2; 3; }\n4;");
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "script_bundle.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// a script of a service, either one expression or a few statements
+std::string generate_script(std::size_t seed) {
+    if (seed % 2 == 0) {
+        return std::format("({} + {}) * {} - {} / 7", seed, seed % 13, seed % 7, seed);
+    }
+    return std::format("{} << 2;\n\"script {}\" + \" of the service\";\n{{ (float){} >= 2.5; }}\n",
+                       seed % 31, seed, seed);
+}
+
+void open(const std::filesystem::path &file) {
+    try {
+        script_bundle bundle{file};
+        std::println("{}: {} scripts", file.filename().string(), bundle.size());
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+}
+
+int main() {
+    constexpr std::size_t count = 500;
+    auto directory = std::filesystem::temp_directory_path() / "nscript_bundle_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / "scripts");
+
+    std::vector<bundle_script> scripts;
+    for (std::size_t i = 0; i < count; i++) {
+        std::string name = std::format("service/{:03}.txt", (i * 7) % count);
+        scripts.push_back({name, generate_script(i)});
+        write_file(directory / "scripts" / std::format("{:03}.txt", (i * 7) % count), scripts.back().source);
+    }
+    auto file = directory / "scripts.nsb";
+    script_bundle::pack(file, scripts, true);
+
+    // every source, read file by file or looked up in one mapping
+    auto start = std::chrono::steady_clock::now();
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        bytes += read_file(directory / "scripts" / std::format("{:03}.txt", i)).size();
+    }
+    std::println("files  {:>7.3f} ms, {} scripts, {} bytes", milliseconds_since(start), count, bytes);
+    start = std::chrono::steady_clock::now();
+    script_bundle bundle{file};
+    bytes = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        bytes += bundle.source(std::format("service/{:03}.txt", i)).value().size();
+    }
+    std::println("bundle {:>7.3f} ms, {} scripts, {} bytes", milliseconds_since(start), bundle.size(), bytes);
+
+    bool same = true;
+    std::size_t images = 0;
+    for (const bundle_script &script : scripts) {
+        same = same && bundle.source(script.name) == script.source;
+        images += bundle.image(script.name).has_value();
+    }
+    std::println("same sources: {}, sorted: {} < {}, {} images", same, bundle.name(0), bundle.name(1), images);
+
+    // an image is mapped from the bundle, other scripts are parsed from it
+    std::string_view expression_name = "service/014.txt";
+    std::println("{}: {} -> {}", expression_name, *bundle.source(expression_name),
+                 describe(bundle.image(expression_name)->evaluate()));
+    loaded_script loaded = load_script(bundle, "service/007.txt");
+    std::println("{}: {} statements", loaded.path.string(), loaded.script->statements().size());
+    loaded = load_script(bundle, "service/missing.txt");
+    std::println("{}: {}", loaded.path.string(), loaded.error);
+    std::println("image of missing: {}", bundle.image("service/missing.txt").has_value());
+
+    // the same name twice, then a truncated and a foreign file
+    try {
+        script_bundle::pack(directory / "twice.nsb", {{"a", "1"}, {"a", "2"}}, false);
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+    std::filesystem::copy_file(file, directory / "truncated.nsb");
+    std::filesystem::resize_file(directory / "truncated.nsb", std::filesystem::file_size(file) - 1);
+    open(directory / "truncated.nsb");
+    open(directory / "scripts" / "000.txt");
+    script_bundle::pack(directory / "empty.nsb", {}, true);
+    open(directory / "empty.nsb");
+
+    std::filesystem::remove_all(directory);
+}
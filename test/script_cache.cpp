@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <string_view>
+#include <variant>
+#include "script_cache.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// balanced expression over 2^depth ones, so the tree stays shallow
+std::string generate_expression(std::size_t depth) {
+    if (depth == 0) {
+        return "1";
+    }
+    std::string half = generate_expression(depth - 1);
+    constexpr std::string_view operators[]{" *\n ", " + ", " - "};
+    return std::format("({}{}{})", half, operators[depth % 3], half);
+}
+
+// loads `file` through the cache and tells whether the image was mapped
+void run(const std::filesystem::path &file, const script_cache &cache) {
+    bool hit = cache.load(script_cache::key(read_file(file))).has_value();
+    try {
+        flat_expression expression = compile_cached(file, cache);
+        value_t value = expression.evaluate();
+        std::println("{}: {} nodes, {}", hit ? "hit " : "miss", expression.size(), describe(value));
+    } catch (std::exception &e) {
+        std::println("{}: {}", hit ? "hit " : "miss", e.what());
+    }
+}
+
+int main() {
+    auto directory = std::filesystem::temp_directory_path() / "nscript_cache_test";
+    std::filesystem::remove_all(directory);
+    script_cache cache{directory / "images"};
+    auto file = directory / "script.txt";
+    std::filesystem::create_directories(directory);
+
+    write_file(file, "\"cached \" + \"string\"");
+    run(file, cache);
+    run(file, cache);
+
+    write_file(file, "(float)(new int[3][4])[2][1] + 2.5 * 4");
+    run(file, cache);
+    run(file, cache);
+
+    // an image of another source under the same name, then a damaged one
+    auto image = cache.image_path(script_cache::key("(float)(new int[3][4])[2][1] + 2.5 * 4"));
+    std::filesystem::copy_file(image, cache.image_path(script_cache::key("1 << 3 | 1")));
+    write_file(file, "1 << 3 | 1");
+    run(file, cache);
+    run(file, cache);
+    std::filesystem::resize_file(image, std::filesystem::file_size(image) - 1);
+    write_file(file, "(float)(new int[3][4])[2][1] + 2.5 * 4");
+    run(file, cache);
+    run(file, cache);
+
+    // execute errors come from a mapped image too, syntax errors store nothing
+    write_file(file, "1 / (2 - 2)");
+    run(file, cache);
+    run(file, cache);
+    write_file(file, "1 + ");
+    run(file, cache);
+    write_file(file, "1 + 2; this is not a script at all (((");
+    run(file, cache);
+    run(file, cache);
+
+    write_file(file, generate_expression(20));
+    auto start = std::chrono::steady_clock::now();
+    auto cold = compile_cached(file, cache);
+    std::println("cold  {:>8.1f} ms, parsed and stored {} nodes", milliseconds_since(start), cold.size());
+    start = std::chrono::steady_clock::now();
+    auto warm = compile_cached(file, cache);
+    std::println("warm  {:>8.1f} ms, mapped {} nodes", milliseconds_since(start), warm.size());
+    std::println("value {}", std::get<int32_t>(warm.evaluate()));
+
+    // a chain as long as the parser accepts, lowered without recursion
+    std::string chain = "1";
+    for (int i = 1; i < 1'000'000; i++) {
+        chain += "+1";
+    }
+    write_file(file, chain);
+    run(file, cache);
+    run(file, cache);
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "reparse.h"
+#include "script_loader.h"
+#include "common.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+// expression statements, empty ones and blocks, one per line
+std::string generate_script(std::size_t lines, std::size_t seed) {
+    std::string source;
+    for (std::size_t i = seed; i < seed + lines; i++) {
+        switch (i % 4) {
+            case 0:
+                source += std::format("({} + {}) * {} - {} / 7;\n", i, i % 13, i % 7, i);
+                break;
+            case 1:
+                source += std::format("{{ {} << 2; (float){} >= 2.5; }}\n", i % 31, i);
+                break;
+            case 2:
+                source += std::format("\"line {}\" + \" of the script\";\n", i);
+                break;
+            default:
+                source += ";\n";
+                break;
+        }
+    }
+    return source;
+}
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "nscript_loader_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::filesystem::path> paths;
+    for (std::size_t i = 0; i < 400; i++) {
+        paths.push_back(directory / std::format("script_{}.txt", i));
+        write_file(paths.back(), generate_script(500, i * 500));
+    }
+    paths.push_back(directory / "broken.txt");
+    write_file(paths.back(), "1 + 2;\n(3 * 4;\n");
+    paths.push_back(directory / "missing.txt");
+
+    std::size_t expected = 0;
+    for (const loaded_script &loaded : load_scripts(paths, 1)) {
+        if (loaded.script) {
+            expected += loaded.script->statements().size();
+        } else {
+            std::println("{}: {}", loaded.path.filename().string(), loaded.error);
+        }
+    }
+
+    std::println("{} files, {} statements", paths.size(), expected);
+    for (std::size_t threads : {1, 2, 4, 8, 16}) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<loaded_script> scripts = load_scripts(paths, threads);
+        double time = milliseconds_since(start);
+        std::size_t statements = 0;
+        std::size_t failed = 0;
+        bool in_order = true;
+        for (std::size_t i = 0; i < scripts.size(); i++) {
+            in_order = in_order && scripts[i].path == paths[i];
+            if (scripts[i].script) {
+                statements += scripts[i].script->statements().size();
+            } else {
+                failed++;
+            }
+        }
+        std::println("{:>2} threads {:>8.1f} ms, {} failed, same statements: {}, in order: {}",
+                     threads, time, failed, statements == expected, in_order);
+    }
+
+    // a script owns only its own nodes, so an edit to it is reparsed in place
+    std::vector<loaded_script> scripts = load_scripts(paths, 4);
+    const program &loaded = *scripts.front().script;
+    std::string source = read_file(paths.front());
+    source.insert(0, "1;\n");
+    program edited = reparse(loaded, source, {0, 0, 3});
+    std::unordered_set<const statement_node *> old;
+    for (const statement_extent &statement : loaded.statements()) {
+        old.insert(statement.statement);
+    }
+    std::size_t parsed = 0;
+    for (const statement_extent &statement : edited.statements()) {
+        parsed += !old.contains(statement.statement);
+    }
+    std::println("edited {} statements, {} parsed again, its arena shared by {} programs",
+                 edited.statements().size(), parsed, loaded.arenas().front().use_count());
+
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,32 @@
+#include <cstddef>
+#include <print>
+#include <thread>
+#include "detail/spsc_queue.h"
+
+using namespace neroll::script::detail;
+
+int main() {
+    spsc_queue<std::size_t, 8> queue;
+    std::println("capacity: {}", queue.capacity());
+
+    constexpr std::size_t count = 100000;
+    std::jthread producer([&](std::stop_token stop) {
+        for (std::size_t i = 0; i < count && queue.wait_for_space(stop); i++) {
+            *queue.back() = i;
+            queue.push();
+        }
+    });
+
+    std::size_t sum = 0;
+    std::size_t out_of_order = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        std::size_t *value;
+        while ((value = queue.front()) == nullptr) {
+            queue.wait_for_element();
+        }
+        sum += *value;
+        out_of_order += *value != i;
+        queue.pop();
+    }
+    std::println("sum: {}, out of order: {}", sum, out_of_order);
+}
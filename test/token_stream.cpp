@@ -0,0 +1,26 @@
+#include <cstdint>
+#include <exception>
+#include <print>
+#include "parser.h"
+
+using namespace neroll::script;
+using namespace neroll::script::detail;
+
+int main() {
+    try {
+        token_stream stream{lexer{mmap_input_adapter{"../../../../script/main.txt"}}};
+        std::println("tokens: {}", stream.size());
+        for (std::size_t i = 0; i < stream.size(); i++) {
+            token tok = stream.at(i);
+            position_t position = stream.position_at(tok.offset);
+            std::println("{} at {}:{}", tok, position.lines_read + 1, position.chars_read_current_line);
+        }
+
+        parser psr{std::move(stream)};
+        auto node = psr.parse_expression();
+        node->evaluate();
+        std::println("value: {}", node->get<int32_t>());
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+}
@@ -0,0 +1,31 @@
+#include <exception>
+#include <print>
+#include <string_view>
+
+#include "detail/lexer.h"
+
+using namespace neroll::script::detail;
+
+void lex(std::string_view source) {
+    try {
+        lexer lex(span_input_adapter{source});
+        for (token tok = lex.next_token(); tok.type != token_type::end_of_input; tok = lex.next_token()) {
+            std::print("{} ", tok);
+        }
+        std::println("");
+    } catch (std::exception &e) {
+        std::println("{}", e.what());
+    }
+}
+
+int main() {
+    lex("größe = \"値段: 100 €\" + значение;");
+    lex("naïve_2 == \"emoji \\\"😀\\\"\\n\";");
+    // a lone continuation byte, an overlong '/' and a cut off sequence
+    lex("x = \"\x80\";");
+    lex("\xC0\xAF = 1;");
+    lex("name\xE4\xB8");
+    // a number ran into a letter takes all of its bytes
+    lex("1é + 1;");
+    lex("2\xC3");
+}
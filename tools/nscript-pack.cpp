@@ -0,0 +1,67 @@
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "script_bundle.h"
+
+using namespace neroll::script;
+
+// nscript-pack [--images] <bundle> <file or directory>...
+//
+// a file is packed under its file name, the files under a directory under
+// their path relative to it, with / between the parts
+namespace {
+
+std::string read_file(const std::filesystem::path &file) {
+    std::ifstream fin(file, std::ios::binary);
+    if (!fin) {
+        throw std::runtime_error("cannot read " + file.string());
+    }
+    return {std::istreambuf_iterator<char>(fin), {}};
+}
+
+void add(std::vector<bundle_script> &scripts, const std::filesystem::path &input) {
+    if (!std::filesystem::is_directory(input)) {
+        scripts.push_back({input.filename().generic_string(), read_file(input)});
+        return;
+    }
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(input)) {
+        if (entry.is_regular_file()) {
+            scripts.push_back({entry.path().lexically_relative(input).generic_string(), read_file(entry.path())});
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::span<char *> args{argv + 1, static_cast<std::size_t>(argc - 1)};
+    bool images = !args.empty() && std::string_view{args.front()} == "--images";
+    if (images) {
+        args = args.subspan(1);
+    }
+    if (args.size() < 2) {
+        std::println(stderr, "usage: nscript-pack [--images] <bundle> <file or directory>...");
+        return 2;
+    }
+    try {
+        std::vector<bundle_script> scripts;
+        for (const char *input : args.subspan(1)) {
+            add(scripts, input);
+        }
+        const std::size_t count = scripts.size();
+        script_bundle::pack(args.front(), std::move(scripts), images);
+        std::println("packed {} scripts into {}", count, args.front());
+    } catch (const std::exception &e) {
+        std::println(stderr, "nscript-pack: {}", e.what());
+        return 1;
+    }
+}
@@ -11,6 +11,13 @@ target("nscript-interpreter")
     --     add_links("stdc++exp")
     -- end
 
+target("nscript-pack")
+    set_kind("binary")
+    add_files("tools/nscript-pack.cpp")
+    set_languages("c++23")
+    set_warnings("all", "error")
+    add_includedirs("include")
+
 
 for _, file in ipairs(os.files("test/*.cpp")) do
     local name = path.basename(file)